@@ -0,0 +1,412 @@
+#ifndef AMIC_ARCHIVE_H_
+#define AMIC_ARCHIVE_H_
+
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/*
+ * Each block is archived as a hot record and a cold record, which the
+ * caller appends to separate files and indexes by block number.
+ *
+ * hot:  header delta | varint len, uncles | varint len, proposals |
+ *       varint tx count | per tx: varint len, raw transaction
+ * cold: per tx: varint len, witnesses
+ *
+ * The header delta is a flag byte followed by only those header fields
+ * the flags do not predict from the previous header, in header order.
+ * A keyframe record predicts nothing from its predecessor, so decoding
+ * can start at any keyframe.
+ */
+#define AMIC_ARCHIVE_SAME_VERSION 0x01
+#define AMIC_ARCHIVE_SAME_TARGET 0x02
+#define AMIC_ARCHIVE_NEXT_NUMBER 0x04
+#define AMIC_ARCHIVE_NEXT_EPOCH 0x08
+#define AMIC_ARCHIVE_PARENT 0x10
+#define AMIC_ARCHIVE_NO_PROPOSALS 0x20
+#define AMIC_ARCHIVE_NO_UNCLES 0x40
+#define AMIC_ARCHIVE_KEYFRAME 0x80
+
+/*
+ * Worst case header delta: flags, two u32, three varints, four hashes, dao
+ * and nonce.
+ */
+#define AMIC_ARCHIVE_MAX_HEADER (1 + 8 + 30 + 32 * 4 + 48)
+
+/*
+ * The previous header and its hash, carried from record to record by both
+ * the encoder and the decoder. keyframe is the block number interval at
+ * which the encoder emits keyframes.
+ */
+typedef struct {
+  uint8_t header[AMIC_HEADER_SIZE];
+  uint8_t hash[AMIC_HASH_SIZE];
+  bool valid;
+  uint64_t keyframe;
+} N(ArchiveContext);
+
+/*
+ * Starts with a zeroed previous header, so the predictions the first
+ * keyframe computes and discards read defined memory.
+ */
+void N(ArchiveContextInit)(N(ArchiveContext) * c, uint64_t keyframe) {
+  memset(c, 0, sizeof(N(ArchiveContext)));
+  c->keyframe = (keyframe == 0) ? 1 : keyframe;
+}
+
+const uint8_t archiveZeroHash[AMIC_HASH_SIZE] = {0};
+
+uint8_t* archiveWriteVarint(uint8_t* p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+bool archiveReadVarint(const uint8_t** p, const uint8_t* end, uint64_t* v) {
+  *v = 0;
+  for (int shift = 0; (shift < 64) && (*p < end); shift += 7) {
+    uint8_t b = *(*p)++;
+    *v |= (uint64_t)(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool archiveReadLength(const uint8_t** p, const uint8_t* end, uint32_t* len) {
+  uint64_t v;
+  if ((!archiveReadVarint(p, end, &v)) || (v > (uint64_t)(end - *p))) {
+    return false;
+  }
+  *len = (uint32_t)v;
+  return true;
+}
+
+uint32_t archiveU32(const uint8_t* h, uint32_t offset) {
+  return *((uint32_t*)&h[offset]);
+}
+
+uint64_t archiveU64(const uint8_t* h, uint32_t offset) {
+  return *((uint64_t*)&h[offset]);
+}
+
+/* CKB epochs pack (length << 40) | (index << 24) | number. */
+uint64_t archiveNextEpoch(uint64_t epoch) {
+  uint64_t length = (epoch >> 40) & 0xffff;
+  uint64_t index = (epoch >> 24) & 0xffff;
+  if (index + 1 >= length) {
+    return UINT64_MAX;
+  }
+  return epoch + (1ULL << 24);
+}
+
+uint8_t* archiveEncodeHeader(N(ArchiveContext) * c, const uint8_t* h,
+                             uint8_t* p) {
+  const uint8_t* prev = c->header;
+  uint64_t number = archiveU64(h, 16);
+  uint8_t flags = 0;
+  if ((!c->valid) || (number % c->keyframe == 0)) {
+    flags |= AMIC_ARCHIVE_KEYFRAME;
+  } else {
+    if (archiveU32(h, 0) == archiveU32(prev, 0)) {
+      flags |= AMIC_ARCHIVE_SAME_VERSION;
+    }
+    if (archiveU32(h, 4) == archiveU32(prev, 4)) {
+      flags |= AMIC_ARCHIVE_SAME_TARGET;
+    }
+    if (number == archiveU64(prev, 16) + 1) {
+      flags |= AMIC_ARCHIVE_NEXT_NUMBER;
+    }
+    if (archiveU64(h, 24) == archiveNextEpoch(archiveU64(prev, 24))) {
+      flags |= AMIC_ARCHIVE_NEXT_EPOCH;
+    }
+    if (memcmp(&h[32], c->hash, AMIC_HASH_SIZE) == 0) {
+      flags |= AMIC_ARCHIVE_PARENT;
+    }
+  }
+  if (memcmp(&h[96], archiveZeroHash, AMIC_HASH_SIZE) == 0) {
+    flags |= AMIC_ARCHIVE_NO_PROPOSALS;
+  }
+  if (memcmp(&h[128], archiveZeroHash, AMIC_HASH_SIZE) == 0) {
+    flags |= AMIC_ARCHIVE_NO_UNCLES;
+  }
+  *p++ = flags;
+  if (!(flags & AMIC_ARCHIVE_SAME_VERSION)) {
+    memcpy(p, &h[0], 4);
+    p += 4;
+  }
+  if (!(flags & AMIC_ARCHIVE_SAME_TARGET)) {
+    memcpy(p, &h[4], 4);
+    p += 4;
+  }
+  uint64_t timestamp = archiveU64(h, 8);
+  if (flags & AMIC_ARCHIVE_KEYFRAME) {
+    p = archiveWriteVarint(p, timestamp);
+  } else {
+    int64_t delta = (int64_t)(timestamp - archiveU64(prev, 8));
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    p = archiveWriteVarint(p, zigzag);
+  }
+  if (!(flags & AMIC_ARCHIVE_NEXT_NUMBER)) {
+    p = archiveWriteVarint(p, number);
+  }
+  if (!(flags & AMIC_ARCHIVE_NEXT_EPOCH)) {
+    p = archiveWriteVarint(p, archiveU64(h, 24));
+  }
+  if (!(flags & AMIC_ARCHIVE_PARENT)) {
+    memcpy(p, &h[32], AMIC_HASH_SIZE);
+    p += AMIC_HASH_SIZE;
+  }
+  memcpy(p, &h[64], AMIC_HASH_SIZE);
+  p += AMIC_HASH_SIZE;
+  if (!(flags & AMIC_ARCHIVE_NO_PROPOSALS)) {
+    memcpy(p, &h[96], AMIC_HASH_SIZE);
+    p += AMIC_HASH_SIZE;
+  }
+  if (!(flags & AMIC_ARCHIVE_NO_UNCLES)) {
+    memcpy(p, &h[128], AMIC_HASH_SIZE);
+    p += AMIC_HASH_SIZE;
+  }
+  memcpy(p, &h[160], AMIC_HEADER_SIZE - 160);
+  return p + AMIC_HEADER_SIZE - 160;
+}
+
+bool archiveDecodeHeader(N(ArchiveContext) * c, const uint8_t** p,
+                         const uint8_t* end, uint8_t* h) {
+  const uint8_t* prev = c->header;
+  if (*p >= end) {
+    return false;
+  }
+  uint8_t flags = *(*p)++;
+  bool keyframe = (flags & AMIC_ARCHIVE_KEYFRAME) != 0;
+  if ((!keyframe) && (!c->valid)) {
+    return false;
+  }
+  uint32_t fixed = 4 * !(flags & AMIC_ARCHIVE_SAME_VERSION) +
+                   4 * !(flags & AMIC_ARCHIVE_SAME_TARGET);
+  if ((uint64_t)(end - *p) < fixed) {
+    return false;
+  }
+  memcpy(&h[0], (flags & AMIC_ARCHIVE_SAME_VERSION) ? prev : *p, 4);
+  *p += (flags & AMIC_ARCHIVE_SAME_VERSION) ? 0 : 4;
+  memcpy(&h[4], (flags & AMIC_ARCHIVE_SAME_TARGET) ? &prev[4] : *p, 4);
+  *p += (flags & AMIC_ARCHIVE_SAME_TARGET) ? 0 : 4;
+  uint64_t v;
+  if (!archiveReadVarint(p, end, &v)) {
+    return false;
+  }
+  uint64_t timestamp =
+      keyframe ? v : archiveU64(prev, 8) + ((v >> 1) ^ (0 - (v & 1)));
+  memcpy(&h[8], &timestamp, 8);
+  uint64_t number = archiveU64(prev, 16) + 1;
+  if ((!(flags & AMIC_ARCHIVE_NEXT_NUMBER)) &&
+      (!archiveReadVarint(p, end, &number))) {
+    return false;
+  }
+  memcpy(&h[16], &number, 8);
+  uint64_t epoch = archiveNextEpoch(archiveU64(prev, 24));
+  if ((!(flags & AMIC_ARCHIVE_NEXT_EPOCH)) &&
+      (!archiveReadVarint(p, end, &epoch))) {
+    return false;
+  }
+  memcpy(&h[24], &epoch, 8);
+  uint32_t hashes = 1 + !(flags & AMIC_ARCHIVE_PARENT) +
+                    !(flags & AMIC_ARCHIVE_NO_PROPOSALS) +
+                    !(flags & AMIC_ARCHIVE_NO_UNCLES);
+  if ((uint64_t)(end - *p) <
+      hashes * AMIC_HASH_SIZE + AMIC_HEADER_SIZE - 160) {
+    return false;
+  }
+  const uint8_t* parent = c->hash;
+  if (!(flags & AMIC_ARCHIVE_PARENT)) {
+    parent = *p;
+    *p += AMIC_HASH_SIZE;
+  }
+  memcpy(&h[32], parent, AMIC_HASH_SIZE);
+  memcpy(&h[64], *p, AMIC_HASH_SIZE);
+  *p += AMIC_HASH_SIZE;
+  const uint8_t* proposals = archiveZeroHash;
+  if (!(flags & AMIC_ARCHIVE_NO_PROPOSALS)) {
+    proposals = *p;
+    *p += AMIC_HASH_SIZE;
+  }
+  memcpy(&h[96], proposals, AMIC_HASH_SIZE);
+  const uint8_t* uncles = archiveZeroHash;
+  if (!(flags & AMIC_ARCHIVE_NO_UNCLES)) {
+    uncles = *p;
+    *p += AMIC_HASH_SIZE;
+  }
+  memcpy(&h[128], uncles, AMIC_HASH_SIZE);
+  memcpy(&h[160], *p, AMIC_HEADER_SIZE - 160);
+  *p += AMIC_HEADER_SIZE - 160;
+  return true;
+}
+
+void archiveAdvance(N(ArchiveContext) * c, const uint8_t* header,
+                    N(Hasher) * h) {
+  memcpy(c->header, header, AMIC_HEADER_SIZE);
+  N(HasherHash)(h, header, AMIC_HEADER_SIZE, c->hash);
+  c->valid = true;
+}
+
+/*
+ * Appends the hot and cold records of a verified block, which must follow
+ * the context's previous block unless it becomes a keyframe.
+ */
+bool N(ArchiveEncode)(N(ArchiveContext) * c, N(Block) * b, N(Hasher) * h,
+                      N(Buffer) * hot, N(Buffer) * cold) {
+  N(Header) header = N(BlockHeader)(b);
+  N(UncleBlockDynVec) uncles = N(BlockUncles)(b);
+  N(TransactionDynVec) txs = N(BlockTransactions)(b);
+  N(ProposalShortIdFixVec) proposals = N(BlockProposals)(b);
+  uint32_t n = N(TransactionDynVecLen)(&txs);
+  if ((!N(BufferReserve)(hot, AMIC_ARCHIVE_MAX_HEADER + 30 + b->s.length +
+                                  10 * n)) ||
+      (!N(BufferReserve)(cold, 10 * n + b->s.length))) {
+    return false;
+  }
+  uint8_t* p = &hot->p[hot->length];
+  p = archiveEncodeHeader(c, (uint8_t*)header.s.p, p);
+  p = archiveWriteVarint(p, uncles.s.length);
+  memcpy(p, uncles.s.p, uncles.s.length);
+  p += uncles.s.length;
+  p = archiveWriteVarint(p, proposals.s.length);
+  memcpy(p, proposals.s.p, proposals.s.length);
+  p += proposals.s.length;
+  p = archiveWriteVarint(p, n);
+  uint8_t* q = &cold->p[cold->length];
+  for (uint32_t i = 0; i < n; i++) {
+    N(Transaction) tx = N(TransactionDynVecGet)(&txs, i);
+    N(RawTransaction) raw = N(TransactionRaw)(&tx);
+    N(BytesDynVec) witnesses = N(TransactionWitnesses)(&tx);
+    p = archiveWriteVarint(p, raw.s.length);
+    memcpy(p, raw.s.p, raw.s.length);
+    p += raw.s.length;
+    q = archiveWriteVarint(q, witnesses.s.length);
+    memcpy(q, witnesses.s.p, witnesses.s.length);
+    q += witnesses.s.length;
+  }
+  hot->length = (uint32_t)(p - hot->p);
+  cold->length = (uint32_t)(q - cold->p);
+  archiveAdvance(c, (uint8_t*)header.s.p, h);
+  return true;
+}
+
+uint8_t* archiveWord(uint8_t* p, uint32_t v) {
+  *((uint32_t*)p) = v;
+  return p + 4;
+}
+
+/*
+ * Rebuilds a block from its records into out with one reservation. With
+ * the cold record the result is byte-identical to the archived block;
+ * with cold NULL every transaction gets an empty witness vector, which
+ * keeps transaction hashes intact and still passes BlockVerify. Either
+ * way the context advances to this block.
+ */
+bool N(ArchiveDecode)(N(ArchiveContext) * c, N(Hasher) * h, N(Slice) * hot,
+                      N(Slice) * cold, N(Buffer) * out, N(Block) * block) {
+  const uint8_t* p = (const uint8_t*)hot->p;
+  const uint8_t* end = p + hot->length;
+  uint8_t header[AMIC_HEADER_SIZE];
+  uint32_t unclesLength, proposalsLength;
+  uint64_t n;
+  if (!archiveDecodeHeader(c, &p, end, header)) {
+    return false;
+  }
+  if (!archiveReadLength(&p, end, &unclesLength)) {
+    return false;
+  }
+  const uint8_t* uncles = p;
+  p += unclesLength;
+  if (!archiveReadLength(&p, end, &proposalsLength)) {
+    return false;
+  }
+  const uint8_t* proposals = p;
+  p += proposalsLength;
+  if ((!archiveReadVarint(&p, end, &n)) || (n > hot->length)) {
+    return false;
+  }
+  /* First pass: sizes only. */
+  const uint8_t* txStart = p;
+  const uint8_t* q = (cold != NULL) ? (const uint8_t*)cold->p : NULL;
+  const uint8_t* coldEnd = (cold != NULL) ? q + cold->length : NULL;
+  uint64_t body = (n == 0) ? 4 : 4 + 4 * n;
+  for (uint64_t i = 0; i < n; i++) {
+    uint32_t rawLength, witnessLength = 4;
+    if (!archiveReadLength(&p, end, &rawLength)) {
+      return false;
+    }
+    p += rawLength;
+    if ((cold != NULL) && (!archiveReadLength(&q, coldEnd, &witnessLength))) {
+      return false;
+    }
+    q += (cold != NULL) ? witnessLength : 0;
+    body += 12 + (uint64_t)rawLength + witnessLength;
+  }
+  if ((p != end) || ((cold != NULL) && (q != coldEnd))) {
+    return false;
+  }
+  uint64_t total = 20 + AMIC_HEADER_SIZE + (uint64_t)unclesLength + body +
+                   proposalsLength;
+  if ((total > UINT32_MAX) || (!N(BufferReserve)(out, (uint32_t)total))) {
+    return false;
+  }
+  uint8_t* start = &out->p[out->length];
+  uint8_t* w = archiveWord(start, (uint32_t)total);
+  w = archiveWord(w, 20);
+  w = archiveWord(w, 20 + AMIC_HEADER_SIZE);
+  w = archiveWord(w, 20 + AMIC_HEADER_SIZE + unclesLength);
+  w = archiveWord(w, 20 + AMIC_HEADER_SIZE + unclesLength + (uint32_t)body);
+  memcpy(w, header, AMIC_HEADER_SIZE);
+  w += AMIC_HEADER_SIZE;
+  memcpy(w, uncles, unclesLength);
+  w += unclesLength;
+  /* Second pass: offsets, then transaction tables. */
+  w = archiveWord(w, (uint32_t)body);
+  uint8_t* offsets = w;
+  w += 4 * n;
+  p = txStart;
+  q = (cold != NULL) ? (const uint8_t*)cold->p : NULL;
+  for (uint64_t i = 0; i < n; i++) {
+    uint32_t rawLength, witnessLength = 4;
+    archiveReadLength(&p, end, &rawLength);
+    if (cold != NULL) {
+      archiveReadLength(&q, coldEnd, &witnessLength);
+    }
+    archiveWord(&offsets[4 * i], (uint32_t)(w - offsets + 4));
+    w = archiveWord(w, 12 + rawLength + witnessLength);
+    w = archiveWord(w, 12);
+    w = archiveWord(w, 12 + rawLength);
+    memcpy(w, p, rawLength);
+    w += rawLength;
+    p += rawLength;
+    if (cold != NULL) {
+      memcpy(w, q, witnessLength);
+      q += witnessLength;
+      w += witnessLength;
+    } else {
+      w = archiveWord(w, 4);
+    }
+  }
+  memcpy(w, proposals, proposalsLength);
+  block->s.p = start;
+  block->s.length = (uint32_t)total;
+  out->length += (uint32_t)total;
+  archiveAdvance(c, header, h);
+  return true;
+}
+
+#undef N
+
+#endif /* AMIC_ARCHIVE_H_ */
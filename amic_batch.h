@@ -0,0 +1,254 @@
+#ifndef AMIC_BATCH_H_
+#define AMIC_BATCH_H_
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/* Transactions verified together; one bit each in a uint64_t mask. */
+#define AMIC_BATCH_CHUNK 64
+
+/* How many transactions ahead the header phase prefetches. */
+#define AMIC_BATCH_PREFETCH 4
+
+/*
+ * Bounds of one transaction's fields, as offsets into the transaction:
+ * raw fields version, cell_deps, header_deps, inputs, outputs and
+ * outputs_data run from fields[f] to fields[f + 1], witnesses from
+ * fields[7] to fields[8].
+ */
+typedef struct {
+  const uint8_t* p;
+  uint32_t fields[9];
+  uint32_t outputCount;
+  uint32_t dataCount;
+  uint32_t witnessCount;
+} batchState;
+
+uint32_t batchWord(const uint8_t* p, uint32_t pos) {
+  return *((uint32_t*)&p[pos]);
+}
+
+/*
+ * The header checks core's table verifiers make on p[start..end): fills
+ * o[0..fields] with the field bounds, relative to p, and requires them to
+ * be non-decreasing.
+ */
+bool batchTable(const uint8_t* p, uint32_t start, uint32_t end, int fields,
+                bool compatible, uint32_t* o) {
+  uint32_t length = end - start;
+  if (length < 8) {
+    return false;
+  }
+  const uint8_t* t = &p[start];
+  uint32_t first = batchWord(t, 4);
+  if ((batchWord(t, 0) != length) || (first % 4 != 0) || (first < 8) ||
+      (first > length)) {
+    return false;
+  }
+  uint32_t count = first / 4 - 1;
+  if ((count < (uint32_t)fields) ||
+      ((!compatible) && (count > (uint32_t)fields))) {
+    return false;
+  }
+  uint32_t last = (count > (uint32_t)fields) ? batchWord(t, 4 + 4 * fields)
+                                              : length;
+  if (last > length) {
+    return false;
+  }
+  o[0] = start + first;
+  bool ordered = true;
+  for (int i = 1; i < fields; i++) {
+    o[i] = start + batchWord(t, 4 + 4 * i);
+    ordered &= (o[i] >= o[i - 1]);
+  }
+  o[fields] = start + last;
+  return ordered && (o[fields] >= o[fields - 1]);
+}
+
+/*
+ * Item count of the dynamic vector p[start..end) if its header is sound
+ * and its offsets are in order, or -1.
+ */
+int batchDynVec(const uint8_t* p, uint32_t start, uint32_t end) {
+  uint32_t length = end - start;
+  if ((length < 4) || (batchWord(p, start) != length)) {
+    return -1;
+  }
+  if (length == 4) {
+    return 0;
+  }
+  uint32_t first = (length < 8) ? 0 : batchWord(p, start + 4);
+  if ((first % 4 != 0) || (first < 8) || (first > length)) {
+    return -1;
+  }
+  uint32_t count = first / 4 - 1;
+  bool ordered = true;
+  uint32_t prev = first;
+  for (uint32_t i = 1; i < count; i++) {
+    uint32_t offset = batchWord(p, start + 4 + 4 * i);
+    ordered &= (offset >= prev);
+    prev = offset;
+  }
+  return (ordered && (length >= prev)) ? (int)count : -1;
+}
+
+bool batchFixVec(const uint8_t* p, uint32_t start, uint32_t end,
+                 uint32_t size) {
+  uint32_t length = end - start;
+  return (length >= 4) &&
+         (length == 4 + (uint64_t)batchWord(p, start) * size);
+}
+
+bool batchBytes(const uint8_t* p, uint32_t start, uint32_t end) {
+  uint32_t length = end - start;
+  return (length >= 4) && (length == batchWord(p, start) + 4);
+}
+
+bool batchScript(const uint8_t* p, uint32_t start, uint32_t end,
+                 bool compatible) {
+  uint32_t o[4];
+  if ((!batchTable(p, start, end, 3, compatible, o)) ||
+      (o[1] - o[0] != AMIC_HASH_SIZE) || (o[2] - o[1] != 1)) {
+    return false;
+  }
+  uint8_t hashType = p[o[1]];
+  return ((hashType == AMIC_DATA) || (hashType == AMIC_TYPE)) &&
+         batchBytes(p, o[2], o[3]);
+}
+
+bool batchOutput(const uint8_t* p, uint32_t start, uint32_t end,
+                 bool compatible) {
+  uint32_t o[4];
+  if ((!batchTable(p, start, end, 3, compatible, o)) || (o[1] - o[0] != 8) ||
+      (!batchScript(p, o[1], o[2], compatible))) {
+    return false;
+  }
+  return (o[3] == o[2]) || batchScript(p, o[2], o[3], compatible);
+}
+
+/*
+ * Checks every item of the dynamic vector p[start..end) with count items,
+ * whose offsets batchDynVec already found in order.
+ */
+bool batchItems(const uint8_t* p, uint32_t start, uint32_t end,
+                uint32_t count, bool outputs, bool compatible) {
+  bool ok = true;
+  uint32_t from = (count > 0) ? start + batchWord(p, start + 4) : end;
+  for (uint32_t i = 1; ok && (i <= count); i++) {
+    uint32_t to = (i < count) ? start + batchWord(p, start + 4 + 4 * i) : end;
+    ok = outputs ? batchOutput(p, from, to, compatible)
+                 : batchBytes(p, from, to);
+    from = to;
+  }
+  return ok;
+}
+
+void batchPrefetch(N(Transaction) * txs, uint32_t i, uint32_t end) {
+  if (i + AMIC_BATCH_PREFETCH < end) {
+    __builtin_prefetch(txs[i + AMIC_BATCH_PREFETCH].s.p);
+  }
+}
+
+/* Verifies txs[base..base+n) one phase at a time; returns the pass mask. */
+uint64_t batchChunk(N(Transaction) * txs, uint32_t base, uint32_t n,
+                    bool compatible, batchState* st) {
+  uint64_t live = 0;
+  uint32_t o[3];
+  for (uint32_t i = 0; i < n; i++) {
+    batchPrefetch(txs, base + i, base + n);
+    batchState* s = &st[i];
+    s->p = (const uint8_t*)txs[base + i].s.p;
+    bool ok = batchTable(s->p, 0, txs[base + i].s.length, 2, compatible, o);
+    s->fields[0] = o[0];
+    s->fields[6] = o[1];
+    s->fields[7] = o[1];
+    s->fields[8] = o[2];
+    live |= (uint64_t)ok << i;
+  }
+  for (uint64_t m = live; m != 0; m &= m - 1) {
+    int i = __builtin_ctzll(m);
+    batchState* s = &st[i];
+    bool ok = batchTable(s->p, s->fields[0], s->fields[6], 6, compatible,
+                         s->fields) &&
+              (s->fields[1] - s->fields[0] == 4) &&
+              batchFixVec(s->p, s->fields[1], s->fields[2],
+                          AMIC_CELLDEP_SIZE) &&
+              batchFixVec(s->p, s->fields[2], s->fields[3], AMIC_HASH_SIZE) &&
+              batchFixVec(s->p, s->fields[3], s->fields[4],
+                          AMIC_CELLINPUT_SIZE);
+    live &= ~((uint64_t)!ok << i);
+  }
+  for (uint64_t m = live; m != 0; m &= m - 1) {
+    int i = __builtin_ctzll(m);
+    const uint8_t* deps = &st[i].p[st[i].fields[1]];
+    uint32_t count = batchWord(deps, 0);
+    bool ok = true;
+    for (uint32_t j = 0; j < count; j++) {
+      uint8_t depType = deps[4 + j * AMIC_CELLDEP_SIZE + AMIC_OUTPOINT_SIZE];
+      ok &= (depType == AMIC_CODE) || (depType == AMIC_DEPGROUP);
+    }
+    live &= ~((uint64_t)!ok << i);
+  }
+  for (uint64_t m = live; m != 0; m &= m - 1) {
+    int i = __builtin_ctzll(m);
+    batchState* s = &st[i];
+    int outputs = batchDynVec(s->p, s->fields[4], s->fields[5]);
+    int data = batchDynVec(s->p, s->fields[5], s->fields[6]);
+    int witnesses = batchDynVec(s->p, s->fields[7], s->fields[8]);
+    s->outputCount = (uint32_t)outputs;
+    s->dataCount = (uint32_t)data;
+    s->witnessCount = (uint32_t)witnesses;
+    live &= ~((uint64_t)((outputs | data | witnesses) < 0) << i);
+  }
+  for (uint64_t m = live; m != 0; m &= m - 1) {
+    int i = __builtin_ctzll(m);
+    batchState* s = &st[i];
+    bool ok = batchItems(s->p, s->fields[4], s->fields[5], s->outputCount,
+                         true, compatible);
+    live &= ~((uint64_t)!ok << i);
+  }
+  for (uint64_t m = live; m != 0; m &= m - 1) {
+    int i = __builtin_ctzll(m);
+    batchState* s = &st[i];
+    bool ok = batchItems(s->p, s->fields[5], s->fields[6], s->dataCount,
+                         false, compatible) &&
+              batchItems(s->p, s->fields[7], s->fields[8], s->witnessCount,
+                         false, compatible);
+    live &= ~((uint64_t)!ok << i);
+  }
+  return live;
+}
+
+/*
+ * Verifies count independent transactions, setting bit i % 64 of
+ * results[i / 64] exactly when TransactionVerify(&txs[i], compatible)
+ * would succeed. Rather than descending into each transaction in turn,
+ * every phase (table headers, fixed vector lengths, dynamic vector
+ * offsets, outputs, byte strings) runs over a chunk of 64 transactions
+ * before the next starts, dropping the ones that already failed. Returns
+ * the number of transactions that passed.
+ */
+uint32_t N(TransactionVerifyBatch)(N(Transaction) * txs, uint32_t count,
+                                   bool compatible, uint64_t* results) {
+  batchState st[AMIC_BATCH_CHUNK];
+  uint32_t passed = 0;
+  for (uint32_t base = 0; base < count; base += AMIC_BATCH_CHUNK) {
+    uint32_t n = count - base;
+    if (n > AMIC_BATCH_CHUNK) {
+      n = AMIC_BATCH_CHUNK;
+    }
+    uint64_t live = batchChunk(txs, base, n, compatible, st);
+    results[base / AMIC_BATCH_CHUNK] = live;
+    passed += (uint32_t)__builtin_popcountll(live);
+  }
+  return passed;
+}
+
+#undef N
+
+#endif /* AMIC_BATCH_H_ */
@@ -0,0 +1,326 @@
+#ifndef AMIC_CACHE_H_
+#define AMIC_CACHE_H_
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+#include "amic_epoch.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+#define AMIC_CACHE_BLOCK 0
+#define AMIC_CACHE_TRANSACTION 1
+
+#define AMIC_CACHE_SHARDS 16
+#define AMIC_CACHE_MAX_FIELDS 4
+
+/*
+ * A verified block or transaction plus its top-level offsets, so fields
+ * can be sliced without touching the Molecule header again.
+ */
+typedef struct {
+  epochRetired retired;
+  uint8_t key[AMIC_HASH_SIZE];
+  uint8_t kind;
+  uint8_t referenced;
+  uint32_t fieldCount;
+  uint32_t offsets[AMIC_CACHE_MAX_FIELDS + 1];
+  uint32_t length;
+  uint8_t data[];
+} N(CacheEntry);
+
+typedef struct {
+  epochRetired retired;
+  uint32_t mask;
+  N(CacheEntry) * slots[];
+} cacheTable;
+
+typedef struct {
+  cacheTable* table;
+  pthread_mutex_t lock;
+  uint32_t hand;
+  uint32_t count;
+  uint32_t tombstones;
+  uint64_t bytes;
+  uint64_t budget;
+  epochRetired* retired;
+} __attribute__((aligned(64))) cacheShard;
+
+/*
+ * Entries returned between CacheReadBegin and CacheReadEnd stay valid
+ * until that CacheReadEnd. Lookups never lock. Writers lock only their
+ * shard, evict with a CLOCK hand over the slot table and hand unlinked
+ * entries to the epoch domain.
+ */
+typedef struct {
+  cacheShard shards[AMIC_CACHE_SHARDS];
+  epochDomain readers;
+  bool compatible;
+} N(Cache);
+
+N(CacheEntry) cacheTombstone;
+
+uint64_t cacheKeyWord(const uint8_t* key, int i) {
+  return *((uint64_t*)&key[i * 8]);
+}
+
+cacheTable* cacheTableNew(uint32_t size) {
+  cacheTable* t = (cacheTable*)calloc(
+      1, sizeof(cacheTable) + (size_t)size * sizeof(N(CacheEntry)*));
+  if (t != NULL) {
+    t->mask = size - 1;
+  }
+  return t;
+}
+
+void N(CacheDestroy)(N(Cache) * c) {
+  for (int i = 0; i < AMIC_CACHE_SHARDS; i++) {
+    cacheShard* s = &c->shards[i];
+    if (s->table == NULL) {
+      continue;
+    }
+    for (uint32_t j = 0; j <= s->table->mask; j++) {
+      N(CacheEntry)* e = s->table->slots[j];
+      if ((e != NULL) && (e != &cacheTombstone)) {
+        free(e);
+      }
+    }
+    free(s->table);
+    epochFree(&s->retired);
+    pthread_mutex_destroy(&s->lock);
+  }
+}
+
+/*
+ * budget is the total number of data bytes kept across all shards; slots is
+ * the slot table size of each shard and bounds its entry count to 3/4 of it.
+ */
+bool N(CacheInit)(N(Cache) * c, uint64_t budget, uint32_t slots,
+                  bool compatible) {
+  memset(c, 0, sizeof(N(Cache)));
+  epochInit(&c->readers);
+  uint32_t size = 16;
+  while ((size < slots) && (size < (1u << 30))) {
+    size *= 2;
+  }
+  for (int i = 0; i < AMIC_CACHE_SHARDS; i++) {
+    cacheShard* s = &c->shards[i];
+    s->table = cacheTableNew(size);
+    if (s->table == NULL) {
+      N(CacheDestroy)(c);
+      return false;
+    }
+    s->budget = budget / AMIC_CACHE_SHARDS;
+    pthread_mutex_init(&s->lock, NULL);
+  }
+  c->compatible = compatible;
+  return true;
+}
+
+/*
+ * Returns a reader slot for the calling thread, or -1 when all are taken;
+ * release it with CacheUnregisterReader before the thread exits.
+ */
+int N(CacheRegisterReader)(N(Cache) * c) {
+  return epochRegister(&c->readers);
+}
+
+void N(CacheUnregisterReader)(N(Cache) * c, int reader) {
+  epochUnregister(&c->readers, reader);
+}
+
+void N(CacheReadBegin)(N(Cache) * c, int reader) {
+  epochReadBegin(&c->readers, reader);
+}
+
+void N(CacheReadEnd)(N(Cache) * c, int reader) {
+  epochReadEnd(&c->readers, reader);
+}
+
+cacheShard* cacheShardOf(N(Cache) * c, const uint8_t* key) {
+  return &c->shards[cacheKeyWord(key, 0) & (AMIC_CACHE_SHARDS - 1)];
+}
+
+N(CacheEntry) * cacheFind(cacheTable* t, const uint8_t* key, uint8_t kind) {
+  uint32_t i = (uint32_t)cacheKeyWord(key, 1) & t->mask;
+  for (uint32_t probes = 0; probes <= t->mask; probes++) {
+    N(CacheEntry)* e = __atomic_load_n(&t->slots[i], __ATOMIC_ACQUIRE);
+    if (e == NULL) {
+      break;
+    }
+    if ((e != &cacheTombstone) && (e->kind == kind) &&
+        (memcmp(e->key, key, AMIC_HASH_SIZE) == 0)) {
+      return e;
+    }
+    i = (i + 1) & t->mask;
+  }
+  return NULL;
+}
+
+/* Must be called between CacheReadBegin and CacheReadEnd. */
+const N(CacheEntry) * N(CacheGet)(N(Cache) * c, N(Hash) * hash,
+                                  uint8_t kind) {
+  cacheShard* s = cacheShardOf(c, (uint8_t*)hash->s.p);
+  cacheTable* t = __atomic_load_n(&s->table, __ATOMIC_ACQUIRE);
+  N(CacheEntry)* e = cacheFind(t, (uint8_t*)hash->s.p, kind);
+  if ((e != NULL) && (!__atomic_load_n(&e->referenced, __ATOMIC_RELAXED))) {
+    __atomic_store_n(&e->referenced, 1, __ATOMIC_RELAXED);
+  }
+  return e;
+}
+
+N(Slice) N(CacheEntryField)(const N(CacheEntry) * e, uint32_t i) {
+  N(Slice) s;
+  s.p = (void*)&e->data[e->offsets[i]];
+  s.length = e->offsets[i + 1] - e->offsets[i];
+  return s;
+}
+
+N(Block) N(CacheEntryBlock)(const N(CacheEntry) * e) {
+  N(Block) b;
+  b.s.p = (void*)e->data;
+  b.s.length = e->length;
+  return b;
+}
+
+N(Transaction) N(CacheEntryTransaction)(const N(CacheEntry) * e) {
+  N(Transaction) t;
+  t.s.p = (void*)e->data;
+  t.s.length = e->length;
+  return t;
+}
+
+void cacheRetire(N(Cache) * c, cacheShard* s, epochRetired* r) {
+  epochRetire(&c->readers, &s->retired, r);
+}
+
+void cacheInsert(cacheTable* t, N(CacheEntry) * e, uint32_t* tombstones) {
+  uint32_t i = (uint32_t)cacheKeyWord(e->key, 1) & t->mask;
+  while ((t->slots[i] != NULL) && (t->slots[i] != &cacheTombstone)) {
+    i = (i + 1) & t->mask;
+  }
+  if ((t->slots[i] == &cacheTombstone) && (tombstones != NULL)) {
+    (*tombstones)--;
+  }
+  __atomic_store_n(&t->slots[i], e, __ATOMIC_RELEASE);
+}
+
+/* Publishes a tombstone-free copy of the slot table. */
+bool cacheRebuild(N(Cache) * c, cacheShard* s) {
+  cacheTable* old = s->table;
+  cacheTable* t = cacheTableNew(old->mask + 1);
+  if (t == NULL) {
+    return false;
+  }
+  for (uint32_t i = 0; i <= old->mask; i++) {
+    N(CacheEntry)* e = old->slots[i];
+    if ((e != NULL) && (e != &cacheTombstone)) {
+      cacheInsert(t, e, NULL);
+    }
+  }
+  __atomic_store_n(&s->table, t, __ATOMIC_RELEASE);
+  s->tombstones = 0;
+  s->hand = 0;
+  cacheRetire(c, s, &old->retired);
+  return true;
+}
+
+/* Advances the CLOCK hand until an unreferenced entry is evicted. */
+bool cacheEvict(N(Cache) * c, cacheShard* s) {
+  cacheTable* t = s->table;
+  for (uint32_t n = 0; n <= 2 * t->mask + 1; n++) {
+    uint32_t i = s->hand;
+    s->hand = (s->hand + 1) & t->mask;
+    N(CacheEntry)* e = t->slots[i];
+    if ((e == NULL) || (e == &cacheTombstone)) {
+      continue;
+    }
+    if (__atomic_load_n(&e->referenced, __ATOMIC_RELAXED)) {
+      __atomic_store_n(&e->referenced, 0, __ATOMIC_RELAXED);
+      continue;
+    }
+    __atomic_store_n(&t->slots[i], &cacheTombstone, __ATOMIC_RELEASE);
+    s->count--;
+    s->tombstones++;
+    s->bytes -= e->length;
+    cacheRetire(c, s, &e->retired);
+    return true;
+  }
+  return false;
+}
+
+bool cachePut(N(Cache) * c, N(Hash) * hash, uint8_t kind, N(Slice) * data,
+              int offset_count, uint32_t fieldCount) {
+  const uint8_t* key = (uint8_t*)hash->s.p;
+  cacheShard* s = cacheShardOf(c, key);
+  if (data->length > s->budget) {
+    return false;
+  }
+  pthread_mutex_lock(&s->lock);
+  N(CacheEntry)* e = cacheFind(s->table, key, kind);
+  if (e != NULL) {
+    __atomic_store_n(&e->referenced, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s->lock);
+    return true;
+  }
+  uint32_t limit = (s->table->mask + 1) / 4 * 3;
+  while (((s->bytes + data->length > s->budget) || (s->count + 1 > limit)) &&
+         cacheEvict(c, s)) {
+  }
+  bool ok = (s->bytes + data->length <= s->budget) && (s->count + 1 <= limit);
+  if (ok && (s->count + s->tombstones + 1 > limit)) {
+    ok = cacheRebuild(c, s);
+  }
+  if (ok) {
+    e = (N(CacheEntry)*)malloc(sizeof(N(CacheEntry)) + data->length);
+    ok = (e != NULL);
+  }
+  if (ok) {
+    memcpy(e->key, key, AMIC_HASH_SIZE);
+    e->kind = kind;
+    e->referenced = 0;
+    e->fieldCount = fieldCount;
+    for (uint32_t i = 0; i < fieldCount; i++) {
+      e->offsets[i] = extractOffset(data, i, offset_count);
+    }
+    e->offsets[fieldCount] = ((uint32_t)offset_count > fieldCount)
+                                 ? extractOffset(data, fieldCount, offset_count)
+                                 : data->length;
+    e->length = data->length;
+    memcpy(e->data, data->p, data->length);
+    cacheInsert(s->table, e, &s->tombstones);
+    s->count++;
+    s->bytes += data->length;
+  }
+  epochCollect(&c->readers, &s->retired);
+  pthread_mutex_unlock(&s->lock);
+  return ok;
+}
+
+/* Verifies and copies b into the cache under its block hash. */
+bool N(CachePutBlock)(N(Cache) * c, N(Hash) * hash, N(Block) * b) {
+  if (!N(BlockVerify)(b, c->compatible)) {
+    return false;
+  }
+  int offset_count = verifyAndExtractOffsetCount(&b->s, 4, c->compatible);
+  return cachePut(c, hash, AMIC_CACHE_BLOCK, &b->s, offset_count, 4);
+}
+
+bool N(CachePutTransaction)(N(Cache) * c, N(Hash) * hash,
+                            N(Transaction) * t) {
+  if (!N(TransactionVerify)(t, c->compatible)) {
+    return false;
+  }
+  int offset_count = verifyAndExtractOffsetCount(&t->s, 2, c->compatible);
+  return cachePut(c, hash, AMIC_CACHE_TRANSACTION, &t->s, offset_count, 2);
+}
+
+#undef N
+
+#endif /* AMIC_CACHE_H_ */
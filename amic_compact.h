@@ -0,0 +1,438 @@
+#ifndef AMIC_COMPACT_H_
+#define AMIC_COMPACT_H_
+
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/*
+ * table IndexTransaction { index: Uint32, transaction: Transaction }
+ *
+ * table CompactBlock {
+ *   header: Header,
+ *   short_ids: ProposalShortIdVec,
+ *   prefilled_transactions: IndexTransactionVec,
+ *   uncles: UncleBlockVec,
+ *   proposals: ProposalShortIdVec,
+ * }
+ *
+ * A short id is the first 10 bytes of the transaction hash. Uncles travel
+ * in full so a compact block rebuilds without a second lookup table.
+ */
+typedef struct {
+  N(Slice) s;
+} N(IndexTransaction);
+
+bool AMIC_VERIFY_IMPL(IndexTransaction)(N(IndexTransaction) * t,
+                                        bool compatible, N(VerifyError) * err) {
+  int offset_count = verifyAndExtractOffsetCount(&t->s, 2, compatible);
+  if (offset_count < 0) {
+    return verifyFail(err, -offset_count, 0);
+  }
+  uint32_t offset0 = extractOffset(&t->s, 0, offset_count);
+  uint32_t offset1 = extractOffset(&t->s, 1, offset_count);
+  uint32_t offset2 = extractOffset(&t->s, 2, offset_count);
+  if ((offset1 < offset0) || (offset2 < offset1)) {
+    return verifyFailOffsets(err, &t->s, 3, offset_count);
+  }
+  if (offset1 - offset0 != 4) {
+    verifyFail(err, AMIC_ERROR_LENGTH, 0);
+    N(Slice) index = N(SliceSlice)(&t->s, offset0, offset1);
+    return verifyFailIn(err, &t->s, &index, "index", 0);
+  }
+  N(Transaction) tx;
+  tx.s = N(SliceSlice)(&t->s, offset1, offset2);
+  if (!N(TransactionVerifyDetailed)(&tx, compatible, err)) {
+    return verifyFailIn(err, &t->s, &tx.s, "transaction", 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(IndexTransaction, AMIC_STAT_INDEXTRANSACTION)
+
+bool N(IndexTransactionVerify)(N(IndexTransaction) * t, bool compatible) {
+  return N(IndexTransactionVerifyDetailed)(t, compatible, NULL);
+}
+
+uint32_t N(IndexTransactionIndex)(N(IndexTransaction) * t) {
+  N(Slice) s = uncheckedField(&t->s, 0, false);
+  return *((uint32_t*)s.p);
+}
+
+N(Transaction) N(IndexTransactionTransaction)(N(IndexTransaction) * t) {
+  N(Transaction) tx;
+  tx.s = uncheckedField(&t->s, 1, true);
+  return tx;
+}
+
+typedef struct {
+  N(Slice) s;
+} N(IndexTransactionDynVec);
+
+bool AMIC_VERIFY_IMPL(IndexTransactionDynVec)(N(IndexTransactionDynVec) * c,
+                                              bool compatible,
+                                              N(VerifyError) * err) {
+  int offset_count = verifyAndExtractOffsetCount(&c->s, 0, true);
+  if (offset_count < 0) {
+    return verifyFail(err, -offset_count, 0);
+  }
+  for (int i = 0; i < offset_count; i++) {
+    uint32_t start = extractOffset(&c->s, i, offset_count);
+    uint32_t end = extractOffset(&c->s, i + 1, offset_count);
+    if (end < start) {
+      return verifyFail(err, AMIC_ERROR_OFFSET,
+                        offsetEntry(i + 1, offset_count));
+    }
+    N(IndexTransaction) o;
+    o.s = N(SliceSlice)(&c->s, start, end);
+    if (!N(IndexTransactionVerifyDetailed)(&o, compatible, err)) {
+      return verifyFailIn(err, &c->s, &o.s, NULL, (uint32_t)i);
+    }
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(IndexTransactionDynVec,
+                       AMIC_STAT_INDEXTRANSACTIONDYNVEC)
+
+bool N(IndexTransactionDynVecVerify)(N(IndexTransactionDynVec) * c,
+                                     bool compatible) {
+  return N(IndexTransactionDynVecVerifyDetailed)(c, compatible, NULL);
+}
+
+uint32_t N(IndexTransactionDynVecLen)(N(IndexTransactionDynVec) * c) {
+  if (c->s.length < 8) {
+    return 0;
+  } else {
+    return ((uint32_t*)c->s.p)[1] / 4 - 1;
+  }
+}
+
+N(IndexTransaction)
+N(IndexTransactionDynVecGet)(N(IndexTransactionDynVec) * c, uint32_t i) {
+  N(IndexTransaction) o;
+  o.s = uncheckedField(&c->s, i, true);
+  return o;
+}
+
+typedef struct {
+  N(Slice) s;
+} N(CompactBlock);
+
+bool AMIC_VERIFY_IMPL(CompactBlock)(N(CompactBlock) * b, bool compatible,
+                                    N(VerifyError) * err) {
+  int offset_count = verifyAndExtractOffsetCount(&b->s, 5, compatible);
+  if (offset_count < 0) {
+    return verifyFail(err, -offset_count, 0);
+  }
+  uint32_t offsets[6];
+  for (int i = 0; i < 6; i++) {
+    offsets[i] = extractOffset(&b->s, i, offset_count);
+    if ((i > 0) && (offsets[i] < offsets[i - 1])) {
+      return verifyFailOffsets(err, &b->s, 6, offset_count);
+    }
+  }
+  N(Header) h;
+  h.s = N(SliceSlice)(&b->s, offsets[0], offsets[1]);
+  if (!N(HeaderVerifyDetailed)(&h, compatible, err)) {
+    return verifyFailIn(err, &b->s, &h.s, "header", 0);
+  }
+  N(ProposalShortIdFixVec) ids;
+  ids.s = N(SliceSlice)(&b->s, offsets[1], offsets[2]);
+  if (!N(ProposalShortIdFixVecVerifyDetailed)(&ids, compatible, err)) {
+    return verifyFailIn(err, &b->s, &ids.s, "short_ids", 0);
+  }
+  N(IndexTransactionDynVec) tv;
+  tv.s = N(SliceSlice)(&b->s, offsets[2], offsets[3]);
+  if (!N(IndexTransactionDynVecVerifyDetailed)(&tv, compatible, err)) {
+    return verifyFailIn(err, &b->s, &tv.s, "prefilled_transactions", 0);
+  }
+  N(UncleBlockDynVec) uv;
+  uv.s = N(SliceSlice)(&b->s, offsets[3], offsets[4]);
+  if (!N(UncleBlockDynVecVerifyDetailed)(&uv, compatible, err)) {
+    return verifyFailIn(err, &b->s, &uv.s, "uncles", 0);
+  }
+  N(ProposalShortIdFixVec) pv;
+  pv.s = N(SliceSlice)(&b->s, offsets[4], offsets[5]);
+  if (!N(ProposalShortIdFixVecVerifyDetailed)(&pv, compatible, err)) {
+    return verifyFailIn(err, &b->s, &pv.s, "proposals", 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(CompactBlock, AMIC_STAT_COMPACTBLOCK)
+
+bool N(CompactBlockVerify)(N(CompactBlock) * b, bool compatible) {
+  return N(CompactBlockVerifyDetailed)(b, compatible, NULL);
+}
+
+N(Header) N(CompactBlockHeader)(N(CompactBlock) * b) {
+  N(Header) h;
+  h.s = uncheckedField(&b->s, 0, false);
+  return h;
+}
+
+N(ProposalShortIdFixVec) N(CompactBlockShortIds)(N(CompactBlock) * b) {
+  N(ProposalShortIdFixVec) v;
+  v.s = uncheckedField(&b->s, 1, false);
+  return v;
+}
+
+N(IndexTransactionDynVec) N(CompactBlockPrefilled)(N(CompactBlock) * b) {
+  N(IndexTransactionDynVec) v;
+  v.s = uncheckedField(&b->s, 2, false);
+  return v;
+}
+
+N(UncleBlockDynVec) N(CompactBlockUncles)(N(CompactBlock) * b) {
+  N(UncleBlockDynVec) v;
+  v.s = uncheckedField(&b->s, 3, false);
+  return v;
+}
+
+N(ProposalShortIdFixVec) N(CompactBlockProposals)(N(CompactBlock) * b) {
+  N(ProposalShortIdFixVec) v;
+  v.s = uncheckedField(&b->s, 4, true);
+  return v;
+}
+
+/*
+ * Counts the transactions a compact block stands for. Fails when the short
+ * id count does not fit its slice, so loops are never sized by a count the
+ * message cannot back.
+ */
+bool compactCount(N(CompactBlock) * b, uint32_t* n) {
+  N(ProposalShortIdFixVec) ids = N(CompactBlockShortIds)(b);
+  N(IndexTransactionDynVec) prefilled = N(CompactBlockPrefilled)(b);
+  if (ids.s.length < 4) {
+    return false;
+  }
+  uint32_t count = N(ProposalShortIdFixVecLen)(&ids);
+  uint64_t total =
+      (uint64_t)count + N(IndexTransactionDynVecLen)(&prefilled);
+  if ((count > (ids.s.length - 4) / AMIC_PROPOSALSHORTID_SIZE) ||
+      (total > UINT32_MAX)) {
+    return false;
+  }
+  *n = (uint32_t)total;
+  return true;
+}
+
+/* Zero for a malformed compact block. */
+uint32_t N(CompactBlockTransactionCount)(N(CompactBlock) * b) {
+  uint32_t n;
+  return compactCount(b, &n) ? n : 0;
+}
+
+uint8_t* compactWord(uint8_t* p, uint32_t v) {
+  *((uint32_t*)p) = v;
+  return p + 4;
+}
+
+uint8_t* compactPut(uint8_t* p, const N(Slice) * s) {
+  memcpy(p, s->p, s->length);
+  return p + s->length;
+}
+
+void compactShortId(N(Hasher) * h, N(Transaction) * tx, uint8_t* id) {
+  uint8_t hash[AMIC_HASH_SIZE];
+  N(RawTransaction) raw = N(TransactionRaw)(tx);
+  N(HasherHash)(h, raw.s.p, raw.s.length, hash);
+  memcpy(id, hash, AMIC_PROPOSALSHORTID_SIZE);
+}
+
+/*
+ * Encodes a verified block as a compact block appended to out: the
+ * cellbase is prefilled, every other transaction becomes its short id.
+ */
+bool N(CompactBlockBuild)(N(Block) * b, N(Hasher) * h, N(Buffer) * out,
+                          N(CompactBlock) * cb) {
+  N(Header) header = N(BlockHeader)(b);
+  N(UncleBlockDynVec) uncles = N(BlockUncles)(b);
+  N(TransactionDynVec) txs = N(BlockTransactions)(b);
+  N(ProposalShortIdFixVec) proposals = N(BlockProposals)(b);
+  uint32_t n = N(TransactionDynVecLen)(&txs);
+  if (n == 0) {
+    return false;
+  }
+  N(Transaction) cellbase = N(TransactionDynVecGet)(&txs, 0);
+  uint32_t prefilled = 8 + 12 + 4 + cellbase.s.length;
+  uint32_t ids = 4 + AMIC_PROPOSALSHORTID_SIZE * (n - 1);
+  uint64_t total = 24 + (uint64_t)header.s.length + ids + prefilled +
+                   uncles.s.length + proposals.s.length;
+  if ((total > UINT32_MAX) || (!N(BufferReserve)(out, (uint32_t)total))) {
+    return false;
+  }
+  uint8_t* start = &out->p[out->length];
+  uint8_t* p = compactWord(start, (uint32_t)total);
+  uint32_t offset = 24;
+  p = compactWord(p, offset);
+  p = compactWord(p, offset += header.s.length);
+  p = compactWord(p, offset += ids);
+  p = compactWord(p, offset += prefilled);
+  p = compactWord(p, offset += uncles.s.length);
+  p = compactPut(p, &header.s);
+  p = compactWord(p, n - 1);
+  for (uint32_t i = 1; i < n; i++) {
+    N(Transaction) tx = N(TransactionDynVecGet)(&txs, i);
+    compactShortId(h, &tx, p);
+    p += AMIC_PROPOSALSHORTID_SIZE;
+  }
+  p = compactWord(p, prefilled);
+  p = compactWord(p, 8);
+  p = compactWord(p, prefilled - 8);
+  p = compactWord(p, 12);
+  p = compactWord(p, 16);
+  p = compactWord(p, 0);
+  p = compactPut(p, &cellbase.s);
+  p = compactPut(p, &uncles.s);
+  compactPut(p, &proposals.s);
+  cb->s.p = start;
+  cb->s.length = (uint32_t)total;
+  out->length += (uint32_t)total;
+  return true;
+}
+
+/* Finds a mempool transaction whose hash starts with id. */
+typedef bool (*N(MempoolLookup))(void* ctx, N(ProposalShortId) * id,
+                                 N(Transaction) * out);
+
+/*
+ * Fills txs, which must hold CompactBlockTransactionCount entries, with the
+ * prefilled transactions and the mempool's matches for each short id. The
+ * positions still to be fetched from the peer are written to missing, in
+ * ascending order, and their count is returned. Returns -1 when the
+ * prefilled indices are not strictly ascending or out of range, or the
+ * short id count does not fit the message.
+ */
+int N(CompactBlockResolve)(N(CompactBlock) * cb, N(MempoolLookup) lookup,
+                           void* ctx, N(Transaction) * txs,
+                           uint32_t* missing) {
+  N(ProposalShortIdFixVec) ids = N(CompactBlockShortIds)(cb);
+  N(IndexTransactionDynVec) prefilled = N(CompactBlockPrefilled)(cb);
+  uint32_t prefilledCount = N(IndexTransactionDynVecLen)(&prefilled);
+  uint32_t n;
+  if (!compactCount(cb, &n)) {
+    return -1;
+  }
+  uint32_t next = 0;
+  uint32_t shortIndex = 0;
+  int missingCount = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (next < prefilledCount) {
+      N(IndexTransaction) it = N(IndexTransactionDynVecGet)(&prefilled, next);
+      uint32_t index = N(IndexTransactionIndex)(&it);
+      if (index < i) {
+        return -1;
+      }
+      if (index == i) {
+        txs[i] = N(IndexTransactionTransaction)(&it);
+        next++;
+        continue;
+      }
+    }
+    if (shortIndex >= N(ProposalShortIdFixVecLen)(&ids)) {
+      return -1;
+    }
+    N(ProposalShortId) id = N(ProposalShortIdFixVecGet)(&ids, shortIndex++);
+    if (!lookup(ctx, &id, &txs[i])) {
+      txs[i].s.p = NULL;
+      txs[i].s.length = 0;
+      missing[missingCount++] = i;
+    }
+  }
+  return (next == prefilledCount) ? missingCount : -1;
+}
+
+/*
+ * Writes the full block into out with a single reservation, then verifies
+ * it in place. Every transaction that was not prefilled must also hash to
+ * its short id, which catches both short id collisions in the mempool and
+ * wrong transactions from the peer. out is left unchanged on failure.
+ */
+bool N(CompactBlockAssemble)(N(CompactBlock) * cb, N(Transaction) * txs,
+                             N(Hasher) * h, N(Buffer) * out,
+                             N(Block) * block) {
+  N(Header) header = N(CompactBlockHeader)(cb);
+  N(ProposalShortIdFixVec) ids = N(CompactBlockShortIds)(cb);
+  N(IndexTransactionDynVec) prefilled = N(CompactBlockPrefilled)(cb);
+  N(UncleBlockDynVec) uncles = N(CompactBlockUncles)(cb);
+  N(ProposalShortIdFixVec) proposals = N(CompactBlockProposals)(cb);
+  uint32_t prefilledCount = N(IndexTransactionDynVecLen)(&prefilled);
+  uint32_t n;
+  if (!compactCount(cb, &n)) {
+    return false;
+  }
+  uint64_t body = 4 + 4 * (uint64_t)n;
+  for (uint32_t i = 0; i < n; i++) {
+    body += txs[i].s.length;
+  }
+  if (n == 0) {
+    body = 4;
+  }
+  uint64_t total = 20 + (uint64_t)header.s.length + uncles.s.length + body +
+                   proposals.s.length;
+  if ((total > UINT32_MAX) || (!N(BufferReserve)(out, (uint32_t)total))) {
+    return false;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    if (txs[i].s.length == 0) {
+      return false;
+    }
+  }
+  uint8_t* start = &out->p[out->length];
+  uint8_t* p = compactWord(start, (uint32_t)total);
+  uint32_t offset = 20;
+  p = compactWord(p, offset);
+  p = compactWord(p, offset += header.s.length);
+  p = compactWord(p, offset += uncles.s.length);
+  p = compactWord(p, offset += (uint32_t)body);
+  p = compactPut(p, &header.s);
+  p = compactPut(p, &uncles.s);
+  p = compactWord(p, (uint32_t)body);
+  offset = 4 + 4 * n;
+  for (uint32_t i = 0; i < n; i++) {
+    p = compactWord(p, offset);
+    offset += txs[i].s.length;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    p = compactPut(p, &txs[i].s);
+  }
+  compactPut(p, &proposals.s);
+  block->s.p = start;
+  block->s.length = (uint32_t)total;
+  if (!N(BlockVerify)(block, false)) {
+    return false;
+  }
+  N(TransactionDynVec) written = N(BlockTransactions)(block);
+  uint32_t next = 0;
+  uint32_t shortIndex = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (next < prefilledCount) {
+      N(IndexTransaction) it = N(IndexTransactionDynVecGet)(&prefilled, next);
+      if (N(IndexTransactionIndex)(&it) == i) {
+        next++;
+        continue;
+      }
+    }
+    N(ProposalShortId) id = N(ProposalShortIdFixVecGet)(&ids, shortIndex++);
+    N(Transaction) tx = N(TransactionDynVecGet)(&written, i);
+    uint8_t actual[AMIC_PROPOSALSHORTID_SIZE];
+    compactShortId(h, &tx, actual);
+    if (memcmp(actual, id.s.p, AMIC_PROPOSALSHORTID_SIZE) != 0) {
+      return false;
+    }
+  }
+  out->length += (uint32_t)total;
+  return true;
+}
+
+#undef N
+
+#endif /* AMIC_COMPACT_H_ */
@@ -6,6 +6,7 @@
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef AMIC_NAMESPACE
@@ -29,6 +30,15 @@
 #define AMIC_HEADER_SIZE 208
 #define AMIC_PROPOSALSHORTID_SIZE 10
 
+#define AMIC_ERROR_NONE 0
+#define AMIC_ERROR_LENGTH 1
+#define AMIC_ERROR_HEADER 2
+#define AMIC_ERROR_FIELD_COUNT 3
+#define AMIC_ERROR_OFFSET 4
+#define AMIC_ERROR_VALUE 5
+
+#define AMIC_ERROR_MAX_DEPTH 12
+
 typedef struct {
   void* p;
   uint32_t length;
@@ -41,43 +51,459 @@ N(Slice) N(SliceSlice)(N(Slice) * s, uint32_t start, uint32_t end) {
   return r;
 }
 
+/*
+ * Uninstrumented FixVec access for use inside verifiers, so that access
+ * statistics only count calls made by library users.
+ */
+uint32_t fixVecLen(const N(Slice) * s) { return *((uint32_t*)s->p); }
+
+N(Slice) fixVecItem(N(Slice) * s, uint32_t i, uint32_t size) {
+  return N(SliceSlice)(s, 4 + i * size, 4 + (i + 1) * size);
+}
+
+/*
+ * Growable output buffer owned by the caller. reserve, when set, must make
+ * room for at least `needed` more bytes past length (updating p and
+ * capacity) or return false.
+ */
+typedef struct N(Buffer) {
+  uint8_t* p;
+  uint32_t length;
+  uint32_t capacity;
+  bool (*reserve)(struct N(Buffer) * b, uint32_t needed);
+  void* ctx;
+} N(Buffer);
+
+bool N(BufferReserve)(N(Buffer) * b, uint32_t needed) {
+  if (b->capacity - b->length >= needed) {
+    return true;
+  }
+  return (b->reserve != NULL) && b->reserve(b, needed);
+}
+
+/*
+ * Incremental hash supplied by the caller (normally CKB's personalized
+ * blake2b-256); final writes AMIC_HASH_SIZE bytes.
+ */
+typedef struct {
+  void* ctx;
+  void (*init)(void* ctx);
+  void (*update)(void* ctx, const void* data, uint32_t len);
+  void (*final)(void* ctx, uint8_t* out);
+} N(Hasher);
+
+void N(HasherHash)(N(Hasher) * h, const void* data, uint32_t len,
+                   uint8_t* out) {
+  h->init(h->ctx);
+  h->update(h->ctx, data, len);
+  h->final(h->ctx, out);
+}
+
+/*
+ * Filled in only when verification fails. Frames are recorded while the
+ * failure unwinds, so frames[0] is the innermost field; offset is relative
+ * to the start of the slice passed to the outermost *VerifyDetailed call.
+ * A frame with a NULL name is a vector item.
+ */
+typedef struct {
+  const char* name;
+  uint32_t index;
+} N(VerifyErrorFrame);
+
+typedef struct {
+  int code;
+  uint32_t offset;
+  uint32_t depth;
+  N(VerifyErrorFrame) frames[AMIC_ERROR_MAX_DEPTH];
+} N(VerifyError);
+
+bool verifyFail(N(VerifyError) * err, int code, uint32_t offset) {
+  if (err) {
+    err->code = code;
+    err->offset = offset;
+    err->depth = 0;
+  }
+  return false;
+}
+
+bool verifyFailIn(N(VerifyError) * err, const N(Slice) * parent,
+                  const N(Slice) * child, const char* name, uint32_t index) {
+  if (err) {
+    err->offset += (uint32_t)((uint8_t*)child->p - (uint8_t*)parent->p);
+    if (err->depth < AMIC_ERROR_MAX_DEPTH) {
+      err->frames[err->depth].name = name;
+      err->frames[err->depth].index = index;
+      err->depth++;
+    }
+  }
+  return false;
+}
+
+const char* N(VerifyErrorMessage)(int code) {
+  switch (code) {
+    case AMIC_ERROR_NONE:
+      return "ok";
+    case AMIC_ERROR_LENGTH:
+      return "length mismatch";
+    case AMIC_ERROR_HEADER:
+      return "malformed offset header";
+    case AMIC_ERROR_FIELD_COUNT:
+      return "unexpected field count";
+    case AMIC_ERROR_OFFSET:
+      return "offsets out of order";
+    case AMIC_ERROR_VALUE:
+      return "invalid value";
+    default:
+      return "unknown error";
+  }
+}
+
+uint32_t errorPathPut(char* buf, uint32_t len, uint32_t pos, char c) {
+  if (pos + 1 < len) {
+    buf[pos] = c;
+  }
+  return pos + 1;
+}
+
+/*
+ * Writes a path such as "transactions[17].raw.outputs[3].lock.args" into
+ * buf, truncating like snprintf. Returns the untruncated path length.
+ */
+uint32_t N(VerifyErrorPath)(const N(VerifyError) * err, char* buf,
+                            uint32_t len) {
+  uint32_t pos = 0;
+  for (uint32_t i = err->depth; i > 0; i--) {
+    const N(VerifyErrorFrame)* f = &err->frames[i - 1];
+    if (f->name) {
+      if (i != err->depth) {
+        pos = errorPathPut(buf, len, pos, '.');
+      }
+      for (const char* c = f->name; *c; c++) {
+        pos = errorPathPut(buf, len, pos, *c);
+      }
+    } else {
+      char digits[10];
+      int n = 0;
+      uint32_t v = f->index;
+      do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+      } while (v > 0);
+      pos = errorPathPut(buf, len, pos, '[');
+      while (n > 0) {
+        pos = errorPathPut(buf, len, pos, digits[--n]);
+      }
+      pos = errorPathPut(buf, len, pos, ']');
+    }
+  }
+  if (len > 0) {
+    buf[pos < len ? pos : len - 1] = '\0';
+  }
+  return pos;
+}
+
+#define AMIC_STAT_UINT128 0
+#define AMIC_STAT_BYTE32 1
+#define AMIC_STAT_HASH 2
+#define AMIC_STAT_SCRIPTHASHTYPE 3
+#define AMIC_STAT_DEPTYPE 4
+#define AMIC_STAT_BYTES 5
+#define AMIC_STAT_OUTPOINT 6
+#define AMIC_STAT_CELLINPUT 7
+#define AMIC_STAT_SCRIPT 8
+#define AMIC_STAT_CELLOUTPUT 9
+#define AMIC_STAT_CELLDEP 10
+#define AMIC_STAT_CELLDEPFIXVEC 11
+#define AMIC_STAT_HASHFIXVEC 12
+#define AMIC_STAT_CELLINPUTFIXVEC 13
+#define AMIC_STAT_CELLOUTPUTDYNVEC 14
+#define AMIC_STAT_BYTESDYNVEC 15
+#define AMIC_STAT_RAWTRANSACTION 16
+#define AMIC_STAT_TRANSACTION 17
+#define AMIC_STAT_RAWHEADER 18
+#define AMIC_STAT_HEADER 19
+#define AMIC_STAT_PROPOSALSHORTID 20
+#define AMIC_STAT_PROPOSALSHORTIDFIXVEC 21
+#define AMIC_STAT_UNCLEBLOCK 22
+#define AMIC_STAT_UNCLEBLOCKDYNVEC 23
+#define AMIC_STAT_TRANSACTIONDYNVEC 24
+#define AMIC_STAT_BLOCK 25
+#define AMIC_STAT_CELLBASEWITNESS 26
+#define AMIC_STAT_WITNESSARGS 27
+#define AMIC_STAT_OUTPOINTFIXVEC 28
+#define AMIC_STAT_INDEXTRANSACTION 29
+#define AMIC_STAT_INDEXTRANSACTIONDYNVEC 30
+#define AMIC_STAT_COMPACTBLOCK 31
+#define AMIC_STAT_TYPE_COUNT 32
+
+#ifdef AMIC_INSTRUMENT
+
+#ifndef AMIC_STAT_MAX_THREADS
+#define AMIC_STAT_MAX_THREADS 64
+#endif
+
+typedef struct {
+  uint64_t calls;
+  uint64_t bytes;
+  uint64_t failures;
+  uint64_t cycles;
+  uint64_t accesses;
+} N(Stat);
+
+typedef struct {
+  N(Stat) types[AMIC_STAT_TYPE_COUNT];
+} __attribute__((aligned(64))) N(Stats);
+
+/*
+ * Each thread claims its own slot on first use and bumps it with relaxed
+ * load/store pairs; threads beyond AMIC_STAT_MAX_THREADS share the last
+ * slot and fall back to atomic adds. Slots outlive their threads, so
+ * snapshots keep the work done by threads that have exited.
+ */
+N(Stats) statSlots[AMIC_STAT_MAX_THREADS + 1];
+uint32_t statSlotCount;
+__thread N(Stats) * statLocal;
+
+N(Stats) * statThreadSlot() {
+  if (statLocal == NULL) {
+    uint32_t i = __atomic_fetch_add(&statSlotCount, 1, __ATOMIC_RELAXED);
+    statLocal = &statSlots[(i < AMIC_STAT_MAX_THREADS) ? i
+                                                       : AMIC_STAT_MAX_THREADS];
+  }
+  return statLocal;
+}
+
+void statAdd(N(Stats) * slot, uint64_t* counter, uint64_t value) {
+  if (slot == &statSlots[AMIC_STAT_MAX_THREADS]) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+  } else {
+    __atomic_store_n(counter,
+                     __atomic_load_n(counter, __ATOMIC_RELAXED) + value,
+                     __ATOMIC_RELAXED);
+  }
+}
+
+#ifdef AMIC_INSTRUMENT_CYCLES
+uint64_t statCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__riscv)
+  uint64_t c;
+  __asm__ volatile("rdcycle %0" : "=r"(c));
+  return c;
+#else
+#error "AMIC_INSTRUMENT_CYCLES is not supported on this architecture!"
+#endif
+}
+#else
+#define statCycles() 0
+#endif
+
+void statRecordVerify(int type, uint32_t length, bool ok, uint64_t start) {
+  N(Stats)* slot = statThreadSlot();
+  N(Stat)* s = &slot->types[type];
+  statAdd(slot, &s->calls, 1);
+  statAdd(slot, &s->bytes, length);
+  if (!ok) {
+    statAdd(slot, &s->failures, 1);
+  }
+#ifdef AMIC_INSTRUMENT_CYCLES
+  statAdd(slot, &s->cycles, statCycles() - start);
+#endif
+}
+
+void statRecordAccess(int type) {
+  N(Stats)* slot = statThreadSlot();
+  statAdd(slot, &slot->types[type].accesses, 1);
+}
+
+void N(StatsSnapshot)(N(Stats) * out) {
+  uint32_t count = __atomic_load_n(&statSlotCount, __ATOMIC_RELAXED);
+  if (count > AMIC_STAT_MAX_THREADS) {
+    count = AMIC_STAT_MAX_THREADS + 1;
+  }
+  for (int t = 0; t < AMIC_STAT_TYPE_COUNT; t++) {
+    N(Stat)* o = &out->types[t];
+    o->calls = o->bytes = o->failures = o->cycles = o->accesses = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      N(Stat)* s = &statSlots[i].types[t];
+      o->calls += __atomic_load_n(&s->calls, __ATOMIC_RELAXED);
+      o->bytes += __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+      o->failures += __atomic_load_n(&s->failures, __ATOMIC_RELAXED);
+      o->cycles += __atomic_load_n(&s->cycles, __ATOMIC_RELAXED);
+      o->accesses += __atomic_load_n(&s->accesses, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+const char* N(StatTypeName)(int type) {
+  switch (type) {
+    case AMIC_STAT_UINT128:
+      return "Uint128";
+    case AMIC_STAT_BYTE32:
+      return "Byte32";
+    case AMIC_STAT_HASH:
+      return "Hash";
+    case AMIC_STAT_SCRIPTHASHTYPE:
+      return "ScriptHashType";
+    case AMIC_STAT_DEPTYPE:
+      return "DepType";
+    case AMIC_STAT_BYTES:
+      return "Bytes";
+    case AMIC_STAT_OUTPOINT:
+      return "OutPoint";
+    case AMIC_STAT_CELLINPUT:
+      return "CellInput";
+    case AMIC_STAT_SCRIPT:
+      return "Script";
+    case AMIC_STAT_CELLOUTPUT:
+      return "CellOutput";
+    case AMIC_STAT_CELLDEP:
+      return "CellDep";
+    case AMIC_STAT_CELLDEPFIXVEC:
+      return "CellDepFixVec";
+    case AMIC_STAT_HASHFIXVEC:
+      return "HashFixVec";
+    case AMIC_STAT_CELLINPUTFIXVEC:
+      return "CellInputFixVec";
+    case AMIC_STAT_CELLOUTPUTDYNVEC:
+      return "CellOutputDynVec";
+    case AMIC_STAT_BYTESDYNVEC:
+      return "BytesDynVec";
+    case AMIC_STAT_RAWTRANSACTION:
+      return "RawTransaction";
+    case AMIC_STAT_TRANSACTION:
+      return "Transaction";
+    case AMIC_STAT_RAWHEADER:
+      return "RawHeader";
+    case AMIC_STAT_HEADER:
+      return "Header";
+    case AMIC_STAT_PROPOSALSHORTID:
+      return "ProposalShortId";
+    case AMIC_STAT_PROPOSALSHORTIDFIXVEC:
+      return "ProposalShortIdFixVec";
+    case AMIC_STAT_UNCLEBLOCK:
+      return "UncleBlock";
+    case AMIC_STAT_UNCLEBLOCKDYNVEC:
+      return "UncleBlockDynVec";
+    case AMIC_STAT_TRANSACTIONDYNVEC:
+      return "TransactionDynVec";
+    case AMIC_STAT_BLOCK:
+      return "Block";
+    case AMIC_STAT_CELLBASEWITNESS:
+      return "CellbaseWitness";
+    case AMIC_STAT_WITNESSARGS:
+      return "WitnessArgs";
+    case AMIC_STAT_OUTPOINTFIXVEC:
+      return "OutPointFixVec";
+    case AMIC_STAT_INDEXTRANSACTION:
+      return "IndexTransaction";
+    case AMIC_STAT_INDEXTRANSACTIONDYNVEC:
+      return "IndexTransactionDynVec";
+    case AMIC_STAT_COMPACTBLOCK:
+      return "CompactBlock";
+    default:
+      return "unknown";
+  }
+}
+
+#define AMIC_VERIFY_IMPL(t) N(t##VerifyImpl)
+#define AMIC_INSTRUMENT_VERIFY(t, type)                   \
+  bool N(t##VerifyDetailed)(N(t) * p, bool compatible,    \
+                            N(VerifyError) * err) {       \
+    uint64_t start = statCycles();                        \
+    bool ok = N(t##VerifyImpl)(p, compatible, err);       \
+    statRecordVerify(type, p->s.length, ok, start);       \
+    return ok;                                            \
+  }
+#define AMIC_STAT_ACCESS(type) statRecordAccess(type)
+
+#else
+
+#define AMIC_VERIFY_IMPL(t) N(t##VerifyDetailed)
+#define AMIC_INSTRUMENT_VERIFY(t, type)
+#define AMIC_STAT_ACCESS(type) ((void)0)
+
+#endif
+
 typedef struct {
   N(Slice) s;
 } N(Uint128);
 
-bool N(Uint128Verify)(N(Uint128) * p, bool _compatible) {
-  return p->s.length == AMIC_UINT128_SIZE;
+bool AMIC_VERIFY_IMPL(Uint128)(N(Uint128) * p, bool _compatible,
+                               N(VerifyError) * err) {
+  if (p->s.length != AMIC_UINT128_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(Uint128, AMIC_STAT_UINT128)
+
+bool N(Uint128Verify)(N(Uint128) * p, bool compatible) {
+  return N(Uint128VerifyDetailed)(p, compatible, NULL);
 }
 
 typedef struct {
   N(Slice) s;
 } N(Byte32);
 
-bool N(Byte32Verify)(N(Byte32) * p, bool _compatible) {
-  return p->s.length == AMIC_BYTE32_SIZE;
+bool AMIC_VERIFY_IMPL(Byte32)(N(Byte32) * p, bool _compatible,
+                              N(VerifyError) * err) {
+  if (p->s.length != AMIC_BYTE32_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(Byte32, AMIC_STAT_BYTE32)
+
+bool N(Byte32Verify)(N(Byte32) * p, bool compatible) {
+  return N(Byte32VerifyDetailed)(p, compatible, NULL);
 }
 
 typedef struct {
   N(Slice) s;
 } N(Hash);
 
-bool N(HashVerify)(N(Hash) * p, bool _compatible) {
-  return p->s.length == AMIC_HASH_SIZE;
+bool AMIC_VERIFY_IMPL(Hash)(N(Hash) * p, bool _compatible,
+                            N(VerifyError) * err) {
+  if (p->s.length != AMIC_HASH_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(Hash, AMIC_STAT_HASH)
+
+bool N(HashVerify)(N(Hash) * p, bool compatible) {
+  return N(HashVerifyDetailed)(p, compatible, NULL);
 }
 
 typedef struct {
   N(Slice) s;
 } N(ScriptHashType);
 
-bool N(ScriptHashTypeVerify)(N(ScriptHashType) * p, bool _compatible) {
+bool AMIC_VERIFY_IMPL(ScriptHashType)(N(ScriptHashType) * p, bool _compatible,
+                                      N(VerifyError) * err) {
   if (p->s.length != 1) {
-    return 0;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   uint8_t* a = (uint8_t*)p->s.p;
-  return (a[0] == AMIC_DATA) || (a[0] == AMIC_TYPE);
+  if ((a[0] != AMIC_DATA) && (a[0] != AMIC_TYPE)) {
+    return verifyFail(err, AMIC_ERROR_VALUE, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(ScriptHashType, AMIC_STAT_SCRIPTHASHTYPE)
+
+bool N(ScriptHashTypeVerify)(N(ScriptHashType) * p, bool compatible) {
+  return N(ScriptHashTypeVerifyDetailed)(p, compatible, NULL);
 }
 
 uint8_t N(ScriptHashTypeValue)(N(ScriptHashType) * p) {
+  AMIC_STAT_ACCESS(AMIC_STAT_SCRIPTHASHTYPE);
   return ((uint8_t*)p->s.p)[0];
 }
 
@@ -85,29 +511,53 @@ typedef struct {
   N(Slice) s;
 } N(DepType);
 
-bool N(DepTypeVerify)(N(DepType) * p, bool _compatible) {
+bool AMIC_VERIFY_IMPL(DepType)(N(DepType) * p, bool _compatible,
+                               N(VerifyError) * err) {
   if (p->s.length != 1) {
-    return 0;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   uint8_t* a = (uint8_t*)p->s.p;
-  return (a[0] == AMIC_CODE) || (a[0] == AMIC_DEPGROUP);
+  if ((a[0] != AMIC_CODE) && (a[0] != AMIC_DEPGROUP)) {
+    return verifyFail(err, AMIC_ERROR_VALUE, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(DepType, AMIC_STAT_DEPTYPE)
+
+bool N(DepTypeVerify)(N(DepType) * p, bool compatible) {
+  return N(DepTypeVerifyDetailed)(p, compatible, NULL);
 }
 
-uint8_t N(DepTypeValue)(N(DepType) * p) { return ((uint8_t*)p->s.p)[0]; }
+uint8_t N(DepTypeValue)(N(DepType) * p) {
+  AMIC_STAT_ACCESS(AMIC_STAT_DEPTYPE);
+  return ((uint8_t*)p->s.p)[0];
+}
 
 typedef struct {
   N(Slice) s;
 } N(Bytes);
 
-bool N(BytesVerify)(N(Bytes) * p, bool _compatible) {
+bool AMIC_VERIFY_IMPL(Bytes)(N(Bytes) * p, bool _compatible,
+                             N(VerifyError) * err) {
   if (p->s.length < 4) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   uint32_t count = *((uint32_t*)p->s.p);
-  return p->s.length == count + 4;
+  if (p->s.length != count + 4) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(Bytes, AMIC_STAT_BYTES)
+
+bool N(BytesVerify)(N(Bytes) * p, bool compatible) {
+  return N(BytesVerifyDetailed)(p, compatible, NULL);
 }
 
 void* N(BytesValue)(N(Bytes) * p, uint32_t* out_len) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BYTES);
   if (out_len) {
     *out_len = p->s.length - 4;
   }
@@ -119,58 +569,131 @@ typedef struct {
 } N(OutPoint);
 
 N(Hash) N(OutPointTxHash)(N(OutPoint) * p) {
+  AMIC_STAT_ACCESS(AMIC_STAT_OUTPOINT);
   N(Hash) h;
   h.s = N(SliceSlice)(&p->s, 0, 32);
   return h;
 }
 
-uint32_t N(OutPointIndex)(N(OutPoint) * p) { return ((uint32_t*)p->s.p)[8]; }
+uint32_t N(OutPointIndex)(N(OutPoint) * p) {
+  AMIC_STAT_ACCESS(AMIC_STAT_OUTPOINT);
+  return ((uint32_t*)p->s.p)[8];
+}
 
-bool N(OutPointVerify)(N(OutPoint) * p, bool compatible) {
+bool AMIC_VERIFY_IMPL(OutPoint)(N(OutPoint) * p, bool compatible,
+                                N(VerifyError) * err) {
   if (p->s.length != AMIC_OUTPOINT_SIZE) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
-  N(Hash) h = N(OutPointTxHash)(p);
-  return N(HashVerify)(&h, compatible);
+  N(Hash) h;
+  h.s = N(SliceSlice)(&p->s, 0, 32);
+  if (!N(HashVerifyDetailed)(&h, compatible, err)) {
+    return verifyFailIn(err, &p->s, &h.s, "tx_hash", 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(OutPoint, AMIC_STAT_OUTPOINT)
+
+bool N(OutPointVerify)(N(OutPoint) * p, bool compatible) {
+  return N(OutPointVerifyDetailed)(p, compatible, NULL);
+}
+
+typedef struct {
+  N(Slice) s;
+} N(OutPointFixVec);
+
+uint32_t N(OutPointFixVecLen)(N(OutPointFixVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_OUTPOINTFIXVEC);
+  return *((uint32_t*)c->s.p);
+}
+
+N(OutPoint) N(OutPointFixVecGet)(N(OutPointFixVec) * c, uint32_t i) {
+  AMIC_STAT_ACCESS(AMIC_STAT_OUTPOINTFIXVEC);
+  uint32_t start = 4 + i * AMIC_OUTPOINT_SIZE;
+  N(OutPoint) d;
+  d.s = N(SliceSlice)(&c->s, start, start + AMIC_OUTPOINT_SIZE);
+  return d;
+}
+
+bool AMIC_VERIFY_IMPL(OutPointFixVec)(N(OutPointFixVec) * c, bool compatible,
+                                      N(VerifyError) * err) {
+  if (c->s.length < 4) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  uint32_t count = fixVecLen(&c->s);
+  if (c->s.length != 4 + (uint64_t)count * AMIC_OUTPOINT_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    N(OutPoint) d;
+    d.s = fixVecItem(&c->s, i, AMIC_OUTPOINT_SIZE);
+    if (!N(OutPointVerifyDetailed)(&d, compatible, err)) {
+      return verifyFailIn(err, &c->s, &d.s, NULL, i);
+    }
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(OutPointFixVec, AMIC_STAT_OUTPOINTFIXVEC)
+
+bool N(OutPointFixVecVerify)(N(OutPointFixVec) * c, bool compatible) {
+  return N(OutPointFixVecVerifyDetailed)(c, compatible, NULL);
 }
 
 typedef struct {
   N(Slice) s;
 } N(CellInput);
 
-uint64_t N(CellInputSince)(N(CellInput) * p) { return *((uint64_t*)p->s.p); }
+uint64_t N(CellInputSince)(N(CellInput) * p) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLINPUT);
+  return *((uint64_t*)p->s.p);
+}
 
 N(OutPoint) N(CellInputPreviousOutput)(N(CellInput) * p) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLINPUT);
   N(OutPoint) o;
   o.s = N(SliceSlice)(&p->s, 8, 44);
   return o;
 }
 
-bool N(CellInputVerify)(N(CellInput) * p, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellInput)(N(CellInput) * p, bool compatible,
+                                 N(VerifyError) * err) {
   if (p->s.length != AMIC_CELLINPUT_SIZE) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
-  N(OutPoint) o = N(CellInputPreviousOutput)(p);
-  return N(OutPointVerify)(&o, compatible);
+  N(OutPoint) o;
+  o.s = N(SliceSlice)(&p->s, 8, 44);
+  if (!N(OutPointVerifyDetailed)(&o, compatible, err)) {
+    return verifyFailIn(err, &p->s, &o.s, "previous_output", 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(CellInput, AMIC_STAT_CELLINPUT)
+
+bool N(CellInputVerify)(N(CellInput) * p, bool compatible) {
+  return N(CellInputVerifyDetailed)(p, compatible, NULL);
 }
 
 int extractOffsetCount(const N(Slice) * s) {
   if (s->length < 4) {
-    return -1;
+    return -AMIC_ERROR_LENGTH;
   }
   uint32_t slice_len = *((uint32_t*)s->p);
   if (slice_len != s->length) {
-    return -1;
+    return -AMIC_ERROR_LENGTH;
   }
   if (slice_len == 4) {
     return 0;
   }
   if (slice_len < 8) {
-    return -1;
+    return -AMIC_ERROR_HEADER;
   }
   uint32_t first_offset = ((uint32_t*)s->p)[1];
-  if ((first_offset % 4 != 0) || (first_offset < 8)) {
-    return -1;
+  if ((first_offset % 4 != 0) || (first_offset < 8) ||
+      (first_offset > slice_len)) {
+    return -AMIC_ERROR_HEADER;
   }
   return first_offset / 4 - 1;
 }
@@ -182,9 +705,13 @@ int verifyAndExtractOffsetCount(const N(Slice) * s, int expected_field_count,
     return offset_count;
   }
   if (offset_count < expected_field_count) {
-    return -2;
+    return -AMIC_ERROR_FIELD_COUNT;
   } else if ((!compatible) && (offset_count > expected_field_count)) {
-    return -2;
+    return -AMIC_ERROR_FIELD_COUNT;
+  } else if ((offset_count > expected_field_count) &&
+             (((uint32_t*)s->p)[expected_field_count + 1] > s->length)) {
+    /* The first unknown field's offset ends the last known field. */
+    return -AMIC_ERROR_OFFSET;
   }
   return offset_count;
 }
@@ -197,6 +724,23 @@ uint32_t extractOffset(const N(Slice) * s, int index, int offset_count) {
   }
 }
 
+uint32_t offsetEntry(int index, int offset_count) {
+  return (index < offset_count) ? (uint32_t)(index + 1) * 4 : 0;
+}
+
+bool verifyFailOffsets(N(VerifyError) * err, const N(Slice) * s,
+                       int field_count, int offset_count) {
+  if (!err) {
+    return false;
+  }
+  int i = 1;
+  while ((i < field_count) && (extractOffset(s, i, offset_count) >=
+                               extractOffset(s, i - 1, offset_count))) {
+    i++;
+  }
+  return verifyFail(err, AMIC_ERROR_OFFSET, offsetEntry(i, offset_count));
+}
+
 N(Slice) uncheckedField(N(Slice) * s, uint32_t index, bool last) {
   uint32_t start = index + 1;
   uint32_t offset = ((uint32_t*)s->p)[start];
@@ -218,49 +762,59 @@ typedef struct {
   N(Slice) s;
 } N(Script);
 
-bool N(ScriptVerify)(N(Script) * p, bool compatible) {
+bool AMIC_VERIFY_IMPL(Script)(N(Script) * p, bool compatible,
+                              N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&p->s, 3, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&p->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&p->s, 1, offset_count);
   uint32_t offset2 = extractOffset(&p->s, 2, offset_count);
   uint32_t offset3 = extractOffset(&p->s, 3, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1) || (offset3 < offset2)) {
-    return false;
+    return verifyFailOffsets(err, &p->s, 4, offset_count);
   }
   N(Hash) h;
   h.s = N(SliceSlice)(&p->s, offset0, offset1);
-  if (!N(HashVerify)(&h, compatible)) {
-    return false;
+  if (!N(HashVerifyDetailed)(&h, compatible, err)) {
+    return verifyFailIn(err, &p->s, &h.s, "code_hash", 0);
   }
   N(ScriptHashType) t;
   t.s = N(SliceSlice)(&p->s, offset1, offset2);
-  if (!N(ScriptHashTypeVerify)(&t, compatible)) {
-    return false;
+  if (!N(ScriptHashTypeVerifyDetailed)(&t, compatible, err)) {
+    return verifyFailIn(err, &p->s, &t.s, "hash_type", 0);
   }
   N(Bytes) b;
   b.s = N(SliceSlice)(&p->s, offset2, offset3);
-  if (!N(BytesVerify)(&b, compatible)) {
-    return false;
+  if (!N(BytesVerifyDetailed)(&b, compatible, err)) {
+    return verifyFailIn(err, &p->s, &b.s, "args", 0);
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(Script, AMIC_STAT_SCRIPT)
+
+bool N(ScriptVerify)(N(Script) * p, bool compatible) {
+  return N(ScriptVerifyDetailed)(p, compatible, NULL);
+}
+
 N(Hash) N(ScriptCodeHash)(N(Script) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_SCRIPT);
   N(Hash) h;
   h.s = uncheckedField(&s->s, 0, false);
   return h;
 }
 
 N(ScriptHashType) N(ScriptScriptHashType)(N(Script) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_SCRIPT);
   N(ScriptHashType) t;
   t.s = uncheckedField(&s->s, 1, false);
   return t;
 }
 
 N(Bytes) N(ScriptArgs)(N(Script) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_SCRIPT);
   N(Bytes) b;
   b.s = uncheckedField(&s->s, 2, true);
   return b;
@@ -270,52 +824,65 @@ typedef struct {
   N(Slice) s;
 } N(CellOutput);
 
-bool N(CellOutputVerify)(N(CellOutput) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellOutput)(N(CellOutput) * c, bool compatible,
+                                  N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&c->s, 3, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&c->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&c->s, 1, offset_count);
   uint32_t offset2 = extractOffset(&c->s, 2, offset_count);
   uint32_t offset3 = extractOffset(&c->s, 3, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1) || (offset3 < offset2)) {
-    return false;
+    return verifyFailOffsets(err, &c->s, 4, offset_count);
   }
   if (offset1 - offset0 != 8) {
-    return false;
+    verifyFail(err, AMIC_ERROR_LENGTH, 0);
+    N(Slice) capacity = N(SliceSlice)(&c->s, offset0, offset1);
+    return verifyFailIn(err, &c->s, &capacity, "capacity", 0);
   }
   N(Script) lock;
   lock.s = N(SliceSlice)(&c->s, offset1, offset2);
-  if (!N(ScriptVerify)(&lock, compatible)) {
-    return false;
+  if (!N(ScriptVerifyDetailed)(&lock, compatible, err)) {
+    return verifyFailIn(err, &c->s, &lock.s, "lock", 0);
   }
   if (offset3 - offset2 > 0) {
     N(Script) type;
     type.s = N(SliceSlice)(&c->s, offset2, offset3);
-    if (!N(ScriptVerify)(&type, compatible)) {
-      return false;
+    if (!N(ScriptVerifyDetailed)(&type, compatible, err)) {
+      return verifyFailIn(err, &c->s, &type.s, "type", 0);
     }
   }
   return true;
 }
 
-uint64_t N(CellOutputCapacity)(N(Script) * s) {
+AMIC_INSTRUMENT_VERIFY(CellOutput, AMIC_STAT_CELLOUTPUT)
+
+bool N(CellOutputVerify)(N(CellOutput) * c, bool compatible) {
+  return N(CellOutputVerifyDetailed)(c, compatible, NULL);
+}
+
+uint64_t N(CellOutputCapacity)(N(CellOutput) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLOUTPUT);
   N(Slice) slice = uncheckedField(&s->s, 0, false);
   return *((uint64_t*)slice.p);
 }
 
-N(Script) N(CellOutputLock)(N(Script) * s) {
+N(Script) N(CellOutputLock)(N(CellOutput) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLOUTPUT);
   N(Script) lock;
   lock.s = uncheckedField(&s->s, 1, false);
   return lock;
 }
 
-bool N(CellOutputHasType)(N(Script) * s) {
+bool N(CellOutputHasType)(N(CellOutput) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLOUTPUT);
   return uncheckedField(&s->s, 2, true).length > 0;
 }
 
-N(Script) N(CellOutputType)(N(Script) * s) {
+N(Script) N(CellOutputType)(N(CellOutput) * s) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLOUTPUT);
   N(Script) type;
   type.s = uncheckedField(&s->s, 2, true);
   return type;
@@ -326,25 +893,41 @@ typedef struct {
 } N(CellDep);
 
 N(OutPoint) N(CellDepOutPoint)(N(CellDep) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLDEP);
   N(OutPoint) o;
   o.s = N(SliceSlice)(&c->s, 0, 36);
   return o;
 }
 
 N(DepType) N(CellDepDepType)(N(CellDep) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLDEP);
   N(DepType) d;
   d.s = N(SliceSlice)(&c->s, 36, 37);
   return d;
 }
 
-bool N(CellDepVerify)(N(CellDep) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellDep)(N(CellDep) * c, bool compatible,
+                               N(VerifyError) * err) {
   if (c->s.length != AMIC_CELLDEP_SIZE) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  N(OutPoint) o;
+  o.s = N(SliceSlice)(&c->s, 0, 36);
+  if (!N(OutPointVerifyDetailed)(&o, compatible, err)) {
+    return verifyFailIn(err, &c->s, &o.s, "out_point", 0);
+  }
+  N(DepType) d;
+  d.s = N(SliceSlice)(&c->s, 36, 37);
+  if (!N(DepTypeVerifyDetailed)(&d, compatible, err)) {
+    return verifyFailIn(err, &c->s, &d.s, "dep_type", 0);
   }
-  N(OutPoint) o = N(CellDepOutPoint)(c);
-  N(DepType) d = N(CellDepDepType)(c);
-  return (N(OutPointVerify)(&o, compatible)) &&
-         (N(DepTypeVerify)(&d, compatible));
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(CellDep, AMIC_STAT_CELLDEP)
+
+bool N(CellDepVerify)(N(CellDep) * c, bool compatible) {
+  return N(CellDepVerifyDetailed)(c, compatible, NULL);
 }
 
 typedef struct {
@@ -352,120 +935,162 @@ typedef struct {
 } N(CellDepFixVec);
 
 uint32_t N(CellDepFixVecLen)(N(CellDepFixVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLDEPFIXVEC);
   return *((uint32_t*)c->s.p);
 }
 
 N(CellDep) N(CellDepFixVecGet)(N(CellDepFixVec) * c, uint32_t i) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLDEPFIXVEC);
   uint32_t start = 4 + i * AMIC_CELLDEP_SIZE;
   N(CellDep) d;
   d.s = N(SliceSlice)(&c->s, start, start + AMIC_CELLDEP_SIZE);
   return d;
 }
 
-bool N(CellDepFixVecVerify)(N(CellDepFixVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellDepFixVec)(N(CellDepFixVec) * c, bool compatible,
+                                     N(VerifyError) * err) {
   if (c->s.length < 4) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
-  uint32_t count = N(CellDepFixVecLen)(c);
-  if (c->s.length != 4 + count * AMIC_CELLDEP_SIZE) {
-    return false;
+  uint32_t count = fixVecLen(&c->s);
+  if (c->s.length != 4 + (uint64_t)count * AMIC_CELLDEP_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   for (uint32_t i = 0; i < count; i++) {
-    N(CellDep) d = N(CellDepFixVecGet)(c, i);
-    if (!N(CellDepVerify)(&d, compatible)) {
-      return false;
+    N(CellDep) d;
+    d.s = fixVecItem(&c->s, i, AMIC_CELLDEP_SIZE);
+    if (!N(CellDepVerifyDetailed)(&d, compatible, err)) {
+      return verifyFailIn(err, &c->s, &d.s, NULL, i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(CellDepFixVec, AMIC_STAT_CELLDEPFIXVEC)
+
+bool N(CellDepFixVecVerify)(N(CellDepFixVec) * c, bool compatible) {
+  return N(CellDepFixVecVerifyDetailed)(c, compatible, NULL);
+}
+
 typedef struct {
   N(Slice) s;
 } N(HashFixVec);
 
-uint32_t N(HashFixVecLen)(N(HashFixVec) * c) { return *((uint32_t*)c->s.p); }
+uint32_t N(HashFixVecLen)(N(HashFixVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_HASHFIXVEC);
+  return *((uint32_t*)c->s.p);
+}
 
 N(Hash) N(HashFixVecGet)(N(HashFixVec) * c, uint32_t i) {
-  uint32_t start = 4 + i * AMIC_CELLDEP_SIZE;
+  AMIC_STAT_ACCESS(AMIC_STAT_HASHFIXVEC);
+  uint32_t start = 4 + i * AMIC_HASH_SIZE;
   N(Hash) d;
-  d.s = N(SliceSlice)(&c->s, start, start + AMIC_CELLDEP_SIZE);
+  d.s = N(SliceSlice)(&c->s, start, start + AMIC_HASH_SIZE);
   return d;
 }
 
-bool N(HashFixVecVerify)(N(HashFixVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(HashFixVec)(N(HashFixVec) * c, bool compatible,
+                                  N(VerifyError) * err) {
   if (c->s.length < 4) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
-  uint32_t count = N(HashFixVecLen)(c);
-  if (c->s.length != 4 + count * AMIC_CELLDEP_SIZE) {
-    return false;
+  uint32_t count = fixVecLen(&c->s);
+  if (c->s.length != 4 + (uint64_t)count * AMIC_HASH_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   for (uint32_t i = 0; i < count; i++) {
-    N(Hash) d = N(HashFixVecGet)(c, i);
-    if (!N(HashVerify)(&d, compatible)) {
-      return false;
+    N(Hash) d;
+    d.s = fixVecItem(&c->s, i, AMIC_HASH_SIZE);
+    if (!N(HashVerifyDetailed)(&d, compatible, err)) {
+      return verifyFailIn(err, &c->s, &d.s, NULL, i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(HashFixVec, AMIC_STAT_HASHFIXVEC)
+
+bool N(HashFixVecVerify)(N(HashFixVec) * c, bool compatible) {
+  return N(HashFixVecVerifyDetailed)(c, compatible, NULL);
+}
+
 typedef struct {
   N(Slice) s;
 } N(CellInputFixVec);
 
 uint32_t N(CellInputFixVecLen)(N(CellInputFixVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLINPUTFIXVEC);
   return *((uint32_t*)c->s.p);
 }
 
 N(CellInput) N(CellInputFixVecGet)(N(CellInputFixVec) * c, uint32_t i) {
-  uint32_t start = 4 + i * AMIC_CELLDEP_SIZE;
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLINPUTFIXVEC);
+  uint32_t start = 4 + i * AMIC_CELLINPUT_SIZE;
   N(CellInput) d;
-  d.s = N(SliceSlice)(&c->s, start, start + AMIC_CELLDEP_SIZE);
+  d.s = N(SliceSlice)(&c->s, start, start + AMIC_CELLINPUT_SIZE);
   return d;
 }
 
-bool N(CellInputFixVecVerify)(N(CellInputFixVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellInputFixVec)(N(CellInputFixVec) * c, bool compatible,
+                                       N(VerifyError) * err) {
   if (c->s.length < 4) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
-  uint32_t count = N(CellInputFixVecLen)(c);
-  if (c->s.length != 4 + count * AMIC_CELLDEP_SIZE) {
-    return false;
+  uint32_t count = fixVecLen(&c->s);
+  if (c->s.length != 4 + (uint64_t)count * AMIC_CELLINPUT_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   for (uint32_t i = 0; i < count; i++) {
-    N(CellInput) d = N(CellInputFixVecGet)(c, i);
-    if (!N(CellInputVerify)(&d, compatible)) {
-      return false;
+    N(CellInput) d;
+    d.s = fixVecItem(&c->s, i, AMIC_CELLINPUT_SIZE);
+    if (!N(CellInputVerifyDetailed)(&d, compatible, err)) {
+      return verifyFailIn(err, &c->s, &d.s, NULL, i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(CellInputFixVec, AMIC_STAT_CELLINPUTFIXVEC)
+
+bool N(CellInputFixVecVerify)(N(CellInputFixVec) * c, bool compatible) {
+  return N(CellInputFixVecVerifyDetailed)(c, compatible, NULL);
+}
+
 typedef struct {
   N(Slice) s;
 } N(CellOutputDynVec);
 
-bool N(CellOutputDynVecVerify)(N(CellOutputDynVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellOutputDynVec)(N(CellOutputDynVec) * c,
+                                        bool compatible,
+                                        N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&c->s, 0, true);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   for (int i = 0; i < offset_count; i++) {
     uint32_t start = extractOffset(&c->s, i, offset_count);
     uint32_t end = extractOffset(&c->s, i + 1, offset_count);
     if (end < start) {
-      return false;
+      return verifyFail(err, AMIC_ERROR_OFFSET,
+                        offsetEntry(i + 1, offset_count));
     }
     N(CellOutput) o;
     o.s = N(SliceSlice)(&c->s, start, end);
-    if (!N(CellOutputVerify)(&o, compatible)) {
-      return false;
+    if (!N(CellOutputVerifyDetailed)(&o, compatible, err)) {
+      return verifyFailIn(err, &c->s, &o.s, NULL, (uint32_t)i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(CellOutputDynVec, AMIC_STAT_CELLOUTPUTDYNVEC)
+
+bool N(CellOutputDynVecVerify)(N(CellOutputDynVec) * c, bool compatible) {
+  return N(CellOutputDynVecVerifyDetailed)(c, compatible, NULL);
+}
+
 uint32_t N(CellOutputDynVecLen)(N(CellOutputDynVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLOUTPUTDYNVEC);
   if (c->s.length < 8) {
     return 0;
   } else {
@@ -474,6 +1099,7 @@ uint32_t N(CellOutputDynVecLen)(N(CellOutputDynVec) * c) {
 }
 
 N(CellOutput) N(CellOutputDynVecGet)(N(CellOutputDynVec) * c, uint32_t i) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLOUTPUTDYNVEC);
   N(CellOutput) o;
   o.s = uncheckedField(&c->s, i, true);
   return o;
@@ -483,27 +1109,36 @@ typedef struct {
   N(Slice) s;
 } N(BytesDynVec);
 
-bool N(BytesDynVecVerify)(N(BytesDynVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(BytesDynVec)(N(BytesDynVec) * c, bool compatible,
+                                   N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&c->s, 0, true);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   for (int i = 0; i < offset_count; i++) {
     uint32_t start = extractOffset(&c->s, i, offset_count);
     uint32_t end = extractOffset(&c->s, i + 1, offset_count);
     if (end < start) {
-      return false;
+      return verifyFail(err, AMIC_ERROR_OFFSET,
+                        offsetEntry(i + 1, offset_count));
     }
     N(Bytes) o;
     o.s = N(SliceSlice)(&c->s, start, end);
-    if (!N(BytesVerify)(&o, compatible)) {
-      return false;
+    if (!N(BytesVerifyDetailed)(&o, compatible, err)) {
+      return verifyFailIn(err, &c->s, &o.s, NULL, (uint32_t)i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(BytesDynVec, AMIC_STAT_BYTESDYNVEC)
+
+bool N(BytesDynVecVerify)(N(BytesDynVec) * c, bool compatible) {
+  return N(BytesDynVecVerifyDetailed)(c, compatible, NULL);
+}
+
 uint32_t N(BytesDynVecLen)(N(BytesDynVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BYTESDYNVEC);
   if (c->s.length < 8) {
     return 0;
   } else {
@@ -512,6 +1147,7 @@ uint32_t N(BytesDynVecLen)(N(BytesDynVec) * c) {
 }
 
 N(Bytes) N(BytesDynVecGet)(N(BytesDynVec) * c, uint32_t i) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BYTESDYNVEC);
   N(Bytes) o;
   o.s = uncheckedField(&c->s, i, true);
   return o;
@@ -521,79 +1157,94 @@ typedef struct {
   N(Slice) s;
 } N(RawTransaction);
 
-bool N(RawTransactionVerify)(N(RawTransaction) * t, bool compatible) {
+bool AMIC_VERIFY_IMPL(RawTransaction)(N(RawTransaction) * t, bool compatible,
+                                      N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&t->s, 6, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offsets[7];
   for (int i = 0; i < 7; i++) {
     offsets[i] = extractOffset(&t->s, i, offset_count);
     if ((i > 0) && (offsets[i] < offsets[i - 1])) {
-      return false;
+      return verifyFail(err, AMIC_ERROR_OFFSET, offsetEntry(i, offset_count));
     }
   }
   if (offsets[1] - offsets[0] != 4) {
-    return false;
+    verifyFail(err, AMIC_ERROR_LENGTH, 0);
+    N(Slice) version = N(SliceSlice)(&t->s, offsets[0], offsets[1]);
+    return verifyFailIn(err, &t->s, &version, "version", 0);
   }
   N(CellDepFixVec) dv;
   dv.s = N(SliceSlice)(&t->s, offsets[1], offsets[2]);
-  if (!N(CellDepFixVecVerify)(&dv, compatible)) {
-    return false;
+  if (!N(CellDepFixVecVerifyDetailed)(&dv, compatible, err)) {
+    return verifyFailIn(err, &t->s, &dv.s, "cell_deps", 0);
   }
   N(HashFixVec) hv;
   hv.s = N(SliceSlice)(&t->s, offsets[2], offsets[3]);
-  if (!N(HashFixVecVerify)(&hv, compatible)) {
-    return false;
+  if (!N(HashFixVecVerifyDetailed)(&hv, compatible, err)) {
+    return verifyFailIn(err, &t->s, &hv.s, "header_deps", 0);
   }
   N(CellInputFixVec) iv;
   iv.s = N(SliceSlice)(&t->s, offsets[3], offsets[4]);
-  if (!N(CellInputFixVecVerify)(&iv, compatible)) {
-    return false;
+  if (!N(CellInputFixVecVerifyDetailed)(&iv, compatible, err)) {
+    return verifyFailIn(err, &t->s, &iv.s, "inputs", 0);
   }
   N(CellOutputDynVec) ov;
   ov.s = N(SliceSlice)(&t->s, offsets[4], offsets[5]);
-  if (!N(CellOutputDynVecVerify)(&ov, compatible)) {
-    return false;
+  if (!N(CellOutputDynVecVerifyDetailed)(&ov, compatible, err)) {
+    return verifyFailIn(err, &t->s, &ov.s, "outputs", 0);
   }
   N(BytesDynVec) bv;
   bv.s = N(SliceSlice)(&t->s, offsets[5], offsets[6]);
-  if (!N(BytesDynVecVerify)(&bv, compatible)) {
-    return false;
+  if (!N(BytesDynVecVerifyDetailed)(&bv, compatible, err)) {
+    return verifyFailIn(err, &t->s, &bv.s, "outputs_data", 0);
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(RawTransaction, AMIC_STAT_RAWTRANSACTION)
+
+bool N(RawTransactionVerify)(N(RawTransaction) * t, bool compatible) {
+  return N(RawTransactionVerifyDetailed)(t, compatible, NULL);
+}
+
 uint32_t N(RawTransactionVersion)(N(RawTransaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWTRANSACTION);
   N(Slice) slice = uncheckedField(&t->s, 0, false);
   return *((uint32_t*)slice.p);
 }
 
 N(CellDepFixVec) N(RawTransactionCellDeps)(N(RawTransaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWTRANSACTION);
   N(CellDepFixVec) v;
   v.s = uncheckedField(&t->s, 1, false);
   return v;
 }
 
 N(HashFixVec) N(RawTransactionHeaderDeps)(N(RawTransaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWTRANSACTION);
   N(HashFixVec) v;
   v.s = uncheckedField(&t->s, 2, false);
   return v;
 }
 
 N(CellInputFixVec) N(RawTransactionInputs)(N(RawTransaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWTRANSACTION);
   N(CellInputFixVec) v;
   v.s = uncheckedField(&t->s, 3, false);
   return v;
 }
 
 N(CellOutputDynVec) N(RawTransactionOutputs)(N(RawTransaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWTRANSACTION);
   N(CellOutputDynVec) v;
   v.s = uncheckedField(&t->s, 4, false);
   return v;
 }
 
 N(BytesDynVec) N(RawTransactionOutputsData)(N(RawTransaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWTRANSACTION);
   N(BytesDynVec) v;
   v.s = uncheckedField(&t->s, 5, true);
   return v;
@@ -603,93 +1254,153 @@ typedef struct {
   N(Slice) s;
 } N(Transaction);
 
-bool N(TransactionVerify)(N(Transaction) * t, bool compatible) {
+bool AMIC_VERIFY_IMPL(Transaction)(N(Transaction) * t, bool compatible,
+                                   N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&t->s, 2, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&t->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&t->s, 1, offset_count);
   uint32_t offset2 = extractOffset(&t->s, 2, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1)) {
-    return false;
+    return verifyFailOffsets(err, &t->s, 3, offset_count);
   }
   N(RawTransaction) rt;
   rt.s = N(SliceSlice)(&t->s, offset0, offset1);
-  if (!N(RawTransactionVerify)(&rt, compatible)) {
-    return false;
+  if (!N(RawTransactionVerifyDetailed)(&rt, compatible, err)) {
+    return verifyFailIn(err, &t->s, &rt.s, "raw", 0);
   }
   N(BytesDynVec) v;
   v.s = N(SliceSlice)(&t->s, offset1, offset2);
-  if (!N(BytesDynVecVerify)(&v, compatible)) {
-    return false;
+  if (!N(BytesDynVecVerifyDetailed)(&v, compatible, err)) {
+    return verifyFailIn(err, &t->s, &v.s, "witnesses", 0);
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(Transaction, AMIC_STAT_TRANSACTION)
+
+bool N(TransactionVerify)(N(Transaction) * t, bool compatible) {
+  return N(TransactionVerifyDetailed)(t, compatible, NULL);
+}
+
+N(RawTransaction) N(TransactionRaw)(N(Transaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_TRANSACTION);
+  N(RawTransaction) r;
+  r.s = uncheckedField(&t->s, 0, false);
+  return r;
+}
+
+N(BytesDynVec) N(TransactionWitnesses)(N(Transaction) * t) {
+  AMIC_STAT_ACCESS(AMIC_STAT_TRANSACTION);
+  N(BytesDynVec) v;
+  v.s = uncheckedField(&t->s, 1, true);
+  return v;
+}
+
 typedef struct {
   N(Slice) s;
 } N(RawHeader);
 
-uint32_t N(RawHeaderVersion)(N(RawHeader) * h) { return *((uint32_t*)h->s.p); }
+uint32_t N(RawHeaderVersion)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
+  return *((uint32_t*)h->s.p);
+}
 
 uint32_t N(RawHeaderCompactTarget)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   return ((uint32_t*)h->s.p)[1];
 }
 
 uint64_t N(RawHeaderTimestamp)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   return ((uint64_t*)h->s.p)[1];
 }
 
-uint64_t N(RawHeaderNumber)(N(RawHeader) * h) { return ((uint64_t*)h->s.p)[2]; }
+uint64_t N(RawHeaderNumber)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
+  return ((uint64_t*)h->s.p)[2];
+}
 
-uint64_t N(RawHeaderEpoch)(N(RawHeader) * h) { return ((uint64_t*)h->s.p)[3]; }
+uint64_t N(RawHeaderEpoch)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
+  return ((uint64_t*)h->s.p)[3];
+}
 
 N(Hash) N(RawHeaderParentHash)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   N(Hash) r;
   r.s = N(SliceSlice)(&h->s, 32, 64);
   return r;
 }
 
 N(Hash) N(RawHeaderTransactionsRoot)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   N(Hash) r;
   r.s = N(SliceSlice)(&h->s, 64, 96);
   return r;
 }
 
 N(Hash) N(RawHeaderProposalsHash)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   N(Hash) r;
   r.s = N(SliceSlice)(&h->s, 96, 128);
   return r;
 }
 
 N(Hash) N(RawHeaderUnclesHash)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   N(Hash) r;
   r.s = N(SliceSlice)(&h->s, 128, 160);
   return r;
 }
 
 N(Byte32) N(RawHeaderDao)(N(RawHeader) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_RAWHEADER);
   N(Byte32) r;
-  r.s = N(SliceSlice)(&h->s, 160, 196);
+  r.s = N(SliceSlice)(&h->s, 160, 192);
   return r;
 }
 
-bool N(RawHeaderVerify)(N(RawHeader) * h, bool compatible) {
+bool AMIC_VERIFY_IMPL(RawHeader)(N(RawHeader) * h, bool compatible,
+                                 N(VerifyError) * err) {
   if (h->s.length != AMIC_RAWHEADER_SIZE) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  N(Hash) parentHash;
+  parentHash.s = N(SliceSlice)(&h->s, 32, 64);
+  if (!N(HashVerifyDetailed)(&parentHash, compatible, err)) {
+    return verifyFailIn(err, &h->s, &parentHash.s, "parent_hash", 0);
+  }
+  N(Hash) transactionsRoot;
+  transactionsRoot.s = N(SliceSlice)(&h->s, 64, 96);
+  if (!N(HashVerifyDetailed)(&transactionsRoot, compatible, err)) {
+    return verifyFailIn(err, &h->s, &transactionsRoot.s, "transactions_root",
+                        0);
+  }
+  N(Hash) proposalsHash;
+  proposalsHash.s = N(SliceSlice)(&h->s, 96, 128);
+  if (!N(HashVerifyDetailed)(&proposalsHash, compatible, err)) {
+    return verifyFailIn(err, &h->s, &proposalsHash.s, "proposals_hash", 0);
+  }
+  N(Hash) unclesHash;
+  unclesHash.s = N(SliceSlice)(&h->s, 128, 160);
+  if (!N(HashVerifyDetailed)(&unclesHash, compatible, err)) {
+    return verifyFailIn(err, &h->s, &unclesHash.s, "uncles_hash", 0);
+  }
+  N(Byte32) dao;
+  dao.s = N(SliceSlice)(&h->s, 160, 192);
+  if (!N(Byte32VerifyDetailed)(&dao, compatible, err)) {
+    return verifyFailIn(err, &h->s, &dao.s, "dao", 0);
   }
-  N(Hash) parentHash = N(RawHeaderParentHash)(h);
-  N(Hash) transactionsRoot = N(RawHeaderTransactionsRoot)(h);
-  N(Hash) proposalsHash = N(RawHeaderProposalsHash)(h);
-  N(Hash) unclesHash = N(RawHeaderUnclesHash)(h);
-  N(Byte32) dao = N(RawHeaderDao)(h);
+  return true;
+}
 
-  return (N(HashVerify)(&parentHash, compatible)) &&
-         (N(HashVerify)(&transactionsRoot, compatible)) &&
-         (N(HashVerify(&proposalsHash, compatible))) &&
-         (N(HashVerify(&unclesHash, compatible))) &&
-         (N(Byte32Verify(&dao, compatible)));
+AMIC_INSTRUMENT_VERIFY(RawHeader, AMIC_STAT_RAWHEADER)
+
+bool N(RawHeaderVerify)(N(RawHeader) * h, bool compatible) {
+  return N(RawHeaderVerifyDetailed)(h, compatible, NULL);
 }
 
 typedef struct {
@@ -697,33 +1408,60 @@ typedef struct {
 } N(Header);
 
 N(RawHeader) N(HeaderRawHeader)(N(Header) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_HEADER);
   N(RawHeader) r;
   r.s = N(SliceSlice)(&h->s, 0, 192);
   return r;
 }
 
 N(Uint128) N(HeaderNonce)(N(Header) * h) {
+  AMIC_STAT_ACCESS(AMIC_STAT_HEADER);
   N(Uint128) u;
   u.s = N(SliceSlice)(&h->s, 192, 208);
   return u;
 }
 
-bool N(HeaderVerify)(N(Header) * h, bool compatible) {
+bool AMIC_VERIFY_IMPL(Header)(N(Header) * h, bool compatible,
+                              N(VerifyError) * err) {
   if (h->s.length != AMIC_HEADER_SIZE) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  N(RawHeader) r;
+  r.s = N(SliceSlice)(&h->s, 0, 192);
+  if (!N(RawHeaderVerifyDetailed)(&r, compatible, err)) {
+    return verifyFailIn(err, &h->s, &r.s, "raw", 0);
   }
-  N(RawHeader) r = N(HeaderRawHeader)(h);
-  N(Uint128) u = N(HeaderNonce)(h);
-  return (N(RawHeaderVerify)(&r, compatible)) &&
-         (N(Uint128Verify)(&u, compatible));
+  N(Uint128) u;
+  u.s = N(SliceSlice)(&h->s, 192, 208);
+  if (!N(Uint128VerifyDetailed)(&u, compatible, err)) {
+    return verifyFailIn(err, &h->s, &u.s, "nonce", 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(Header, AMIC_STAT_HEADER)
+
+bool N(HeaderVerify)(N(Header) * h, bool compatible) {
+  return N(HeaderVerifyDetailed)(h, compatible, NULL);
 }
 
 typedef struct {
   N(Slice) s;
 } N(ProposalShortId);
 
-bool N(ProposalShortIdVerify)(N(ProposalShortId) * p, bool _compatible) {
-  return p->s.length == AMIC_PROPOSALSHORTID_SIZE;
+bool AMIC_VERIFY_IMPL(ProposalShortId)(N(ProposalShortId) * p,
+                                       bool _compatible,
+                                       N(VerifyError) * err) {
+  if (p->s.length != AMIC_PROPOSALSHORTID_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
+  }
+  return true;
+}
+
+AMIC_INSTRUMENT_VERIFY(ProposalShortId, AMIC_STAT_PROPOSALSHORTID)
+
+bool N(ProposalShortIdVerify)(N(ProposalShortId) * p, bool compatible) {
+  return N(ProposalShortIdVerifyDetailed)(p, compatible, NULL);
 }
 
 typedef struct {
@@ -731,70 +1469,90 @@ typedef struct {
 } N(ProposalShortIdFixVec);
 
 uint32_t N(ProposalShortIdFixVecLen)(N(ProposalShortIdFixVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_PROPOSALSHORTIDFIXVEC);
   return *((uint32_t*)c->s.p);
 }
 
 N(ProposalShortId)
 N(ProposalShortIdFixVecGet)(N(ProposalShortIdFixVec) * c, uint32_t i) {
-  uint32_t start = 4 + i * AMIC_CELLDEP_SIZE;
+  AMIC_STAT_ACCESS(AMIC_STAT_PROPOSALSHORTIDFIXVEC);
+  uint32_t start = 4 + i * AMIC_PROPOSALSHORTID_SIZE;
   N(ProposalShortId) d;
-  d.s = N(SliceSlice)(&c->s, start, start + AMIC_CELLDEP_SIZE);
+  d.s = N(SliceSlice)(&c->s, start, start + AMIC_PROPOSALSHORTID_SIZE);
   return d;
 }
 
-bool N(ProposalShortIdFixVecVerify)(N(ProposalShortIdFixVec) * c,
-                                    bool compatible) {
+bool AMIC_VERIFY_IMPL(ProposalShortIdFixVec)(N(ProposalShortIdFixVec) * c,
+                                             bool compatible,
+                                             N(VerifyError) * err) {
   if (c->s.length < 4) {
-    return false;
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
-  uint32_t count = N(ProposalShortIdFixVecLen)(c);
-  if (c->s.length != 4 + count * AMIC_CELLDEP_SIZE) {
-    return false;
+  uint32_t count = fixVecLen(&c->s);
+  if (c->s.length != 4 + (uint64_t)count * AMIC_PROPOSALSHORTID_SIZE) {
+    return verifyFail(err, AMIC_ERROR_LENGTH, 0);
   }
   for (uint32_t i = 0; i < count; i++) {
-    N(ProposalShortId) d = N(ProposalShortIdFixVecGet)(c, i);
-    if (!N(ProposalShortIdVerify)(&d, compatible)) {
-      return false;
+    N(ProposalShortId) d;
+    d.s = fixVecItem(&c->s, i, AMIC_PROPOSALSHORTID_SIZE);
+    if (!N(ProposalShortIdVerifyDetailed)(&d, compatible, err)) {
+      return verifyFailIn(err, &c->s, &d.s, NULL, i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(ProposalShortIdFixVec, AMIC_STAT_PROPOSALSHORTIDFIXVEC)
+
+bool N(ProposalShortIdFixVecVerify)(N(ProposalShortIdFixVec) * c,
+                                    bool compatible) {
+  return N(ProposalShortIdFixVecVerifyDetailed)(c, compatible, NULL);
+}
+
 typedef struct {
   N(Slice) s;
 } N(UncleBlock);
 
-bool N(UncleBlockVerify)(N(UncleBlock) * b, bool compatible) {
+bool AMIC_VERIFY_IMPL(UncleBlock)(N(UncleBlock) * b, bool compatible,
+                                  N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&b->s, 2, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&b->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&b->s, 1, offset_count);
   uint32_t offset2 = extractOffset(&b->s, 2, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1)) {
-    return false;
+    return verifyFailOffsets(err, &b->s, 3, offset_count);
   }
   N(Header) h;
   h.s = N(SliceSlice)(&b->s, offset0, offset1);
-  if (!N(HeaderVerify)(&h, compatible)) {
-    return false;
+  if (!N(HeaderVerifyDetailed)(&h, compatible, err)) {
+    return verifyFailIn(err, &b->s, &h.s, "header", 0);
   }
   N(ProposalShortIdFixVec) v;
   v.s = N(SliceSlice)(&b->s, offset1, offset2);
-  if (!N(ProposalShortIdFixVecVerify)(&v, compatible)) {
-    return false;
+  if (!N(ProposalShortIdFixVecVerifyDetailed)(&v, compatible, err)) {
+    return verifyFailIn(err, &b->s, &v.s, "proposals", 0);
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(UncleBlock, AMIC_STAT_UNCLEBLOCK)
+
+bool N(UncleBlockVerify)(N(UncleBlock) * b, bool compatible) {
+  return N(UncleBlockVerifyDetailed)(b, compatible, NULL);
+}
+
 N(Header) N(UncleBlockHeader)(N(UncleBlock) * b) {
+  AMIC_STAT_ACCESS(AMIC_STAT_UNCLEBLOCK);
   N(Header) h;
   h.s = uncheckedField(&b->s, 0, false);
   return h;
 }
 
 N(ProposalShortIdFixVec) N(UncleBlockProposals)(N(UncleBlock) * b) {
+  AMIC_STAT_ACCESS(AMIC_STAT_UNCLEBLOCK);
   N(ProposalShortIdFixVec) v;
   v.s = uncheckedField(&b->s, 1, true);
   return v;
@@ -804,27 +1562,37 @@ typedef struct {
   N(Slice) s;
 } N(UncleBlockDynVec);
 
-bool N(UncleBlockDynVecVerify)(N(UncleBlockDynVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(UncleBlockDynVec)(N(UncleBlockDynVec) * c,
+                                        bool compatible,
+                                        N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&c->s, 0, true);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   for (int i = 0; i < offset_count; i++) {
     uint32_t start = extractOffset(&c->s, i, offset_count);
     uint32_t end = extractOffset(&c->s, i + 1, offset_count);
     if (end < start) {
-      return false;
+      return verifyFail(err, AMIC_ERROR_OFFSET,
+                        offsetEntry(i + 1, offset_count));
     }
     N(UncleBlock) o;
     o.s = N(SliceSlice)(&c->s, start, end);
-    if (!N(UncleBlockVerify)(&o, compatible)) {
-      return false;
+    if (!N(UncleBlockVerifyDetailed)(&o, compatible, err)) {
+      return verifyFailIn(err, &c->s, &o.s, NULL, (uint32_t)i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(UncleBlockDynVec, AMIC_STAT_UNCLEBLOCKDYNVEC)
+
+bool N(UncleBlockDynVecVerify)(N(UncleBlockDynVec) * c, bool compatible) {
+  return N(UncleBlockDynVecVerifyDetailed)(c, compatible, NULL);
+}
+
 uint32_t N(UncleBlockDynVecLen)(N(UncleBlockDynVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_UNCLEBLOCKDYNVEC);
   if (c->s.length < 8) {
     return 0;
   } else {
@@ -833,6 +1601,7 @@ uint32_t N(UncleBlockDynVecLen)(N(UncleBlockDynVec) * c) {
 }
 
 N(UncleBlock) N(UncleBlockDynVecGet)(N(UncleBlockDynVec) * c, uint32_t i) {
+  AMIC_STAT_ACCESS(AMIC_STAT_UNCLEBLOCKDYNVEC);
   N(UncleBlock) o;
   o.s = uncheckedField(&c->s, i, true);
   return o;
@@ -842,27 +1611,37 @@ typedef struct {
   N(Slice) s;
 } N(TransactionDynVec);
 
-bool N(TransactionDynVecVerify)(N(TransactionDynVec) * c, bool compatible) {
+bool AMIC_VERIFY_IMPL(TransactionDynVec)(N(TransactionDynVec) * c,
+                                         bool compatible,
+                                         N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&c->s, 0, true);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   for (int i = 0; i < offset_count; i++) {
     uint32_t start = extractOffset(&c->s, i, offset_count);
     uint32_t end = extractOffset(&c->s, i + 1, offset_count);
     if (end < start) {
-      return false;
+      return verifyFail(err, AMIC_ERROR_OFFSET,
+                        offsetEntry(i + 1, offset_count));
     }
     N(Transaction) o;
     o.s = N(SliceSlice)(&c->s, start, end);
-    if (!N(TransactionVerify)(&o, compatible)) {
-      return false;
+    if (!N(TransactionVerifyDetailed)(&o, compatible, err)) {
+      return verifyFailIn(err, &c->s, &o.s, NULL, (uint32_t)i);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(TransactionDynVec, AMIC_STAT_TRANSACTIONDYNVEC)
+
+bool N(TransactionDynVecVerify)(N(TransactionDynVec) * c, bool compatible) {
+  return N(TransactionDynVecVerifyDetailed)(c, compatible, NULL);
+}
+
 uint32_t N(TransactionDynVecLen)(N(TransactionDynVec) * c) {
+  AMIC_STAT_ACCESS(AMIC_STAT_TRANSACTIONDYNVEC);
   if (c->s.length < 8) {
     return 0;
   } else {
@@ -871,6 +1650,7 @@ uint32_t N(TransactionDynVecLen)(N(TransactionDynVec) * c) {
 }
 
 N(Transaction) N(TransactionDynVecGet)(N(TransactionDynVec) * c, uint32_t i) {
+  AMIC_STAT_ACCESS(AMIC_STAT_TRANSACTIONDYNVEC);
   N(Transaction) o;
   o.s = uncheckedField(&c->s, i, true);
   return o;
@@ -880,10 +1660,11 @@ typedef struct {
   N(Slice) s;
 } N(Block);
 
-bool N(BlockVerify)(N(Block) * b, bool compatible) {
+bool AMIC_VERIFY_IMPL(Block)(N(Block) * b, bool compatible,
+                             N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&b->s, 4, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&b->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&b->s, 1, offset_count);
@@ -892,50 +1673,60 @@ bool N(BlockVerify)(N(Block) * b, bool compatible) {
   uint32_t offset4 = extractOffset(&b->s, 4, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1) || (offset3 < offset2) ||
       (offset4 < offset3)) {
-    return false;
+    return verifyFailOffsets(err, &b->s, 5, offset_count);
   }
   N(Header) h;
   h.s = N(SliceSlice)(&b->s, offset0, offset1);
-  if (!N(HeaderVerify)(&h, compatible)) {
-    return false;
+  if (!N(HeaderVerifyDetailed)(&h, compatible, err)) {
+    return verifyFailIn(err, &b->s, &h.s, "header", 0);
   }
   N(UncleBlockDynVec) bv;
   bv.s = N(SliceSlice)(&b->s, offset1, offset2);
-  if (!N(UncleBlockDynVecVerify)(&bv, compatible)) {
-    return false;
+  if (!N(UncleBlockDynVecVerifyDetailed)(&bv, compatible, err)) {
+    return verifyFailIn(err, &b->s, &bv.s, "uncles", 0);
   }
   N(TransactionDynVec) tv;
   tv.s = N(SliceSlice)(&b->s, offset2, offset3);
-  if (!N(TransactionDynVecVerify)(&tv, compatible)) {
-    return false;
+  if (!N(TransactionDynVecVerifyDetailed)(&tv, compatible, err)) {
+    return verifyFailIn(err, &b->s, &tv.s, "transactions", 0);
   }
   N(ProposalShortIdFixVec) v;
   v.s = N(SliceSlice)(&b->s, offset3, offset4);
-  if (!N(ProposalShortIdFixVecVerify)(&v, compatible)) {
-    return false;
+  if (!N(ProposalShortIdFixVecVerifyDetailed)(&v, compatible, err)) {
+    return verifyFailIn(err, &b->s, &v.s, "proposals", 0);
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(Block, AMIC_STAT_BLOCK)
+
+bool N(BlockVerify)(N(Block) * b, bool compatible) {
+  return N(BlockVerifyDetailed)(b, compatible, NULL);
+}
+
 N(Header) N(BlockHeader)(N(Block) * b) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BLOCK);
   N(Header) h;
   h.s = uncheckedField(&b->s, 0, false);
   return h;
 }
 
 N(UncleBlockDynVec) N(BlockUncles)(N(Block) * b) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BLOCK);
   N(UncleBlockDynVec) v;
   v.s = uncheckedField(&b->s, 1, false);
   return v;
 }
 
 N(TransactionDynVec) N(BlockTransactions)(N(Block) * b) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BLOCK);
   N(TransactionDynVec) v;
   v.s = uncheckedField(&b->s, 2, false);
   return v;
 }
 
 N(ProposalShortIdFixVec) N(BlockProposals)(N(Block) * b) {
+  AMIC_STAT_ACCESS(AMIC_STAT_BLOCK);
   N(ProposalShortIdFixVec) v;
   v.s = uncheckedField(&b->s, 3, true);
   return v;
@@ -945,37 +1736,46 @@ typedef struct {
   N(Slice) s;
 } N(CellbaseWitness);
 
-bool N(CellbaseWitnessVerify)(N(CellbaseWitness) * w, bool compatible) {
+bool AMIC_VERIFY_IMPL(CellbaseWitness)(N(CellbaseWitness) * w, bool compatible,
+                                       N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&w->s, 2, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&w->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&w->s, 1, offset_count);
   uint32_t offset2 = extractOffset(&w->s, 2, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1)) {
-    return false;
+    return verifyFailOffsets(err, &w->s, 3, offset_count);
   }
   N(Script) lock;
   lock.s = N(SliceSlice)(&w->s, offset0, offset1);
-  if (!N(ScriptVerify)(&lock, compatible)) {
-    return false;
+  if (!N(ScriptVerifyDetailed)(&lock, compatible, err)) {
+    return verifyFailIn(err, &w->s, &lock.s, "lock", 0);
   }
   N(Bytes) message;
   message.s = N(SliceSlice)(&w->s, offset1, offset2);
-  if (!N(BytesVerify)(&message, compatible)) {
-    return false;
+  if (!N(BytesVerifyDetailed)(&message, compatible, err)) {
+    return verifyFailIn(err, &w->s, &message.s, "message", 0);
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(CellbaseWitness, AMIC_STAT_CELLBASEWITNESS)
+
+bool N(CellbaseWitnessVerify)(N(CellbaseWitness) * w, bool compatible) {
+  return N(CellbaseWitnessVerifyDetailed)(w, compatible, NULL);
+}
+
 N(Script) N(CellbaseWitnessLock)(N(CellbaseWitness) * w) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLBASEWITNESS);
   N(Script) lock;
   lock.s = uncheckedField(&w->s, 0, false);
   return lock;
 }
 
 N(Bytes) N(CellbaseWitnessMessage)(N(CellbaseWitness) * w) {
+  AMIC_STAT_ACCESS(AMIC_STAT_CELLBASEWITNESS);
   N(Bytes) message;
   message.s = uncheckedField(&w->s, 1, true);
   return message;
@@ -985,69 +1785,82 @@ typedef struct {
   N(Slice) s;
 } N(WitnessArgs);
 
-bool N(WitnessArgsVerify)(N(WitnessArgs) * a, bool compatible) {
+bool AMIC_VERIFY_IMPL(WitnessArgs)(N(WitnessArgs) * a, bool compatible,
+                                   N(VerifyError) * err) {
   int offset_count = verifyAndExtractOffsetCount(&a->s, 3, compatible);
   if (offset_count < 0) {
-    return false;
+    return verifyFail(err, -offset_count, 0);
   }
   uint32_t offset0 = extractOffset(&a->s, 0, offset_count);
   uint32_t offset1 = extractOffset(&a->s, 1, offset_count);
   uint32_t offset2 = extractOffset(&a->s, 2, offset_count);
   uint32_t offset3 = extractOffset(&a->s, 3, offset_count);
   if ((offset1 < offset0) || (offset2 < offset1) || (offset3 < offset2)) {
-    return false;
+    return verifyFailOffsets(err, &a->s, 4, offset_count);
   }
   if (offset1 - offset0 > 0) {
     N(Script) lock;
     lock.s = N(SliceSlice)(&a->s, offset0, offset1);
-    if (!N(ScriptVerify)(&lock, compatible)) {
-      return false;
+    if (!N(ScriptVerifyDetailed)(&lock, compatible, err)) {
+      return verifyFailIn(err, &a->s, &lock.s, "lock", 0);
     }
   }
   if (offset2 - offset1 > 0) {
     N(Script) inputType;
     inputType.s = N(SliceSlice)(&a->s, offset1, offset2);
-    if (!N(ScriptVerify)(&inputType, compatible)) {
-      return false;
+    if (!N(ScriptVerifyDetailed)(&inputType, compatible, err)) {
+      return verifyFailIn(err, &a->s, &inputType.s, "input_type", 0);
     }
   }
   if (offset3 - offset2 > 0) {
     N(Script) outputType;
     outputType.s = N(SliceSlice)(&a->s, offset2, offset3);
-    if (!N(ScriptVerify)(&outputType, compatible)) {
-      return false;
+    if (!N(ScriptVerifyDetailed)(&outputType, compatible, err)) {
+      return verifyFailIn(err, &a->s, &outputType.s, "output_type", 0);
     }
   }
   return true;
 }
 
+AMIC_INSTRUMENT_VERIFY(WitnessArgs, AMIC_STAT_WITNESSARGS)
+
+bool N(WitnessArgsVerify)(N(WitnessArgs) * a, bool compatible) {
+  return N(WitnessArgsVerifyDetailed)(a, compatible, NULL);
+}
+
 bool N(WitnessArgsHasLock)(N(WitnessArgs) * a) {
+  AMIC_STAT_ACCESS(AMIC_STAT_WITNESSARGS);
   return uncheckedField(&a->s, 0, false).length > 0;
 }
 
 N(Script) N(WitnessArgsLock)(N(WitnessArgs) * a) {
+  AMIC_STAT_ACCESS(AMIC_STAT_WITNESSARGS);
   N(Script) s;
   s.s = uncheckedField(&a->s, 0, false);
   return s;
 }
 
 bool N(WitnessArgsHasInputType)(N(WitnessArgs) * a) {
-  return uncheckedField(&a->s, 0, false).length > 0;
+  AMIC_STAT_ACCESS(AMIC_STAT_WITNESSARGS);
+  return uncheckedField(&a->s, 1, false).length > 0;
 }
 
 N(Script) N(WitnessArgsInputType)(N(WitnessArgs) * a) {
+  AMIC_STAT_ACCESS(AMIC_STAT_WITNESSARGS);
   N(Script) s;
-  s.s = uncheckedField(&a->s, 0, false);
+  s.s = uncheckedField(&a->s, 1, false);
   return s;
 }
 
 bool N(WitnessArgsHasOutputType)(N(WitnessArgs) * a) {
-  return uncheckedField(&a->s, 0, false).length > 0;
+  AMIC_STAT_ACCESS(AMIC_STAT_WITNESSARGS);
+  return uncheckedField(&a->s, 2, true).length > 0;
 }
 
 N(Script) N(WitnessArgsOutputType)(N(WitnessArgs) * a) {
+  AMIC_STAT_ACCESS(AMIC_STAT_WITNESSARGS);
   N(Script) s;
-  s.s = uncheckedField(&a->s, 0, false);
+  s.s = uncheckedField(&a->s, 2, true);
   return s;
 }
 
@@ -0,0 +1,216 @@
+#ifndef AMIC_DATASTORE_H_
+#define AMIC_DATASTORE_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+#include "amic_hashset.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/* Compact handle to one distinct piece of cell data. */
+typedef uint32_t N(DataRef);
+
+/* bytes holds the data in Molecule Bytes form: length, then content. */
+typedef struct {
+  uint8_t hash[AMIC_HASH_SIZE];
+  uint32_t refs;
+  uint8_t bytes[];
+} N(DataEntry);
+
+/*
+ * Content addressed store for output data. Each distinct content, keyed by
+ * the hash of its bytes (CKB's data hash when hasher is blake2b), is kept
+ * once and refcounted; entries never move, so views stay valid until the
+ * last reference is released. Not thread safe, callers serialize access.
+ */
+typedef struct {
+  N(Hasher) * hasher;
+  N(DataEntry) * *entries;
+  uint32_t* freeRefs;
+  uint32_t freeCount;
+  uint32_t entryCount;
+  uint32_t entryCapacity;
+  hashSet set;
+  uint32_t live;
+  uint64_t storedBytes;
+  uint64_t referencedBytes;
+} N(DataStore);
+
+/* capacity presizes the hash set; it must not exceed AMIC_HASHSET_MAX. */
+bool N(DataStoreInit)(N(DataStore) * d, N(Hasher) * hasher,
+                      uint32_t capacity) {
+  memset(d, 0, sizeof(N(DataStore)));
+  if (!hashSetInit(&d->set, capacity)) {
+    return false;
+  }
+  d->hasher = hasher;
+  return true;
+}
+
+void N(DataStoreDestroy)(N(DataStore) * d) {
+  for (uint32_t i = 0; i < d->entryCount; i++) {
+    free(d->entries[i]);
+  }
+  free(d->entries);
+  free(d->freeRefs);
+  hashSetDestroy(&d->set);
+}
+
+/* Slots hold refs plus one. */
+const uint8_t* dataStoreKey(void* ctx, uint32_t slot) {
+  return ((N(DataStore)*)ctx)->entries[slot - 1]->hash;
+}
+
+uint32_t dataStoreFind(N(DataStore) * d, const uint8_t* hash) {
+  return hashSetFind(&d->set, hash, dataStoreKey, d);
+}
+
+/* Returns a free ref with room reserved for its entry pointer. */
+bool dataStoreAllocRef(N(DataStore) * d, N(DataRef) * ref) {
+  if (d->freeCount > 0) {
+    *ref = d->freeRefs[--d->freeCount];
+    return true;
+  }
+  if (d->entryCount == d->entryCapacity) {
+    uint32_t capacity = (d->entryCapacity == 0) ? 64 : d->entryCapacity * 2;
+    N(DataEntry)** entries = (N(DataEntry)**)realloc(
+        d->entries, capacity * sizeof(N(DataEntry)*));
+    if (entries == NULL) {
+      return false;
+    }
+    d->entries = entries;
+    uint32_t* freeRefs =
+        (uint32_t*)realloc(d->freeRefs, capacity * sizeof(uint32_t));
+    if (freeRefs == NULL) {
+      return false;
+    }
+    d->freeRefs = freeRefs;
+    d->entryCapacity = capacity;
+  }
+  *ref = d->entryCount++;
+  return true;
+}
+
+/*
+ * Adds a reference to data whose hash the caller already knows, copying
+ * the content only when it is new.
+ */
+bool N(DataStorePutHashed)(N(DataStore) * d, const uint8_t* hash,
+                           const void* data, uint32_t length,
+                           N(DataRef) * ref) {
+  uint32_t i = dataStoreFind(d, hash);
+  if (d->set.slots[i] != 0) {
+    *ref = d->set.slots[i] - 1;
+    d->entries[*ref]->refs++;
+    d->referencedBytes += length;
+    return true;
+  }
+  if ((!hashSetReserve(&d->set, d->live + 1, dataStoreKey, d)) ||
+      (!dataStoreAllocRef(d, ref))) {
+    return false;
+  }
+  N(DataEntry)* e = (N(DataEntry)*)malloc(sizeof(N(DataEntry)) + 4 + length);
+  if (e == NULL) {
+    d->entries[*ref] = NULL;
+    d->freeRefs[d->freeCount++] = *ref;
+    return false;
+  }
+  memcpy(e->hash, hash, AMIC_HASH_SIZE);
+  e->refs = 1;
+  *((uint32_t*)e->bytes) = length;
+  memcpy(&e->bytes[4], data, length);
+  d->entries[*ref] = e;
+  d->set.slots[dataStoreFind(d, hash)] = *ref + 1;
+  d->live++;
+  d->storedBytes += length;
+  d->referencedBytes += length;
+  return true;
+}
+
+bool N(DataStorePut)(N(DataStore) * d, N(Bytes) * data, N(DataRef) * ref) {
+  uint32_t length;
+  void* content = N(BytesValue)(data, &length);
+  uint8_t hash[AMIC_HASH_SIZE];
+  N(HasherHash)(d->hasher, content, length, hash);
+  return N(DataStorePutHashed)(d, hash, content, length, ref);
+}
+
+void N(DataStoreRetain)(N(DataStore) * d, N(DataRef) ref) {
+  N(DataEntry)* e = d->entries[ref];
+  e->refs++;
+  d->referencedBytes += *((uint32_t*)e->bytes);
+}
+
+/* Dropping the last reference frees the data and invalidates its views. */
+void N(DataStoreRelease)(N(DataStore) * d, N(DataRef) ref) {
+  N(DataEntry)* e = d->entries[ref];
+  uint32_t length = *((uint32_t*)e->bytes);
+  d->referencedBytes -= length;
+  if (--e->refs > 0) {
+    return;
+  }
+  hashSetErase(&d->set, dataStoreFind(d, e->hash), dataStoreKey, d);
+  d->live--;
+  d->storedBytes -= length;
+  free(e);
+  d->entries[ref] = NULL;
+  d->freeRefs[d->freeCount++] = ref;
+}
+
+/*
+ * Stores every outputs_data entry of a verified transaction, filling one
+ * ref per output. All or nothing: on failure the refs taken so far are
+ * released.
+ */
+bool N(DataStorePutOutputsData)(N(DataStore) * d, N(RawTransaction) * tx,
+                                N(DataRef) * refs) {
+  N(BytesDynVec) data = N(RawTransactionOutputsData)(tx);
+  uint32_t n = N(BytesDynVecLen)(&data);
+  for (uint32_t i = 0; i < n; i++) {
+    N(Bytes) b = N(BytesDynVecGet)(&data, i);
+    if (!N(DataStorePut)(d, &b, &refs[i])) {
+      while (i > 0) {
+        N(DataStoreRelease)(d, refs[--i]);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Looks up content by hash without taking a reference. */
+bool N(DataStoreFind)(N(DataStore) * d, const uint8_t* hash,
+                      N(DataRef) * ref) {
+  uint32_t i = dataStoreFind(d, hash);
+  if (d->set.slots[i] == 0) {
+    return false;
+  }
+  *ref = d->set.slots[i] - 1;
+  return true;
+}
+
+/* Zero-copy view of the stored data. */
+N(Bytes) N(DataStoreBytes)(N(DataStore) * d, N(DataRef) ref) {
+  N(DataEntry)* e = d->entries[ref];
+  N(Bytes) b;
+  b.s.p = e->bytes;
+  b.s.length = 4 + *((uint32_t*)e->bytes);
+  return b;
+}
+
+N(Hash) N(DataStoreHash)(N(DataStore) * d, N(DataRef) ref) {
+  N(Hash) h;
+  h.s.p = d->entries[ref]->hash;
+  h.s.length = AMIC_HASH_SIZE;
+  return h;
+}
+
+#undef N
+
+#endif /* AMIC_DATASTORE_H_ */
@@ -0,0 +1,323 @@
+#ifndef AMIC_DEPGROUP_H_
+#define AMIC_DEPGROUP_H_
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+#include "amic_epoch.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/*
+ * Loads the data of a live cell. The returned bytes only need to stay
+ * valid until the next call on the same thread.
+ */
+typedef bool (*N(CellDataLoader))(void* ctx, N(OutPoint) * outPoint,
+                                  N(Slice) * data);
+
+/* Immutable once published; members is a verified OutPointFixVec. */
+typedef struct N(DepGroupEntry) {
+  epochRetired retired;
+  uint8_t outPoint[AMIC_OUTPOINT_SIZE];
+  uint32_t length;
+  uint8_t members[];
+} N(DepGroupEntry);
+
+typedef struct {
+  epochRetired retired;
+  uint32_t mask;
+  N(DepGroupEntry) * slots[];
+} depGroupTable;
+
+/*
+ * Views returned between DepGroupCacheReadBegin and DepGroupCacheReadEnd
+ * stay valid until that DepGroupCacheReadEnd. Lookups never lock. Inserts
+ * and invalidations are serialized by a mutex, grow or rebuild the slot
+ * table by publishing a copy, and hand unlinked entries and tables to the
+ * epoch domain.
+ */
+typedef struct {
+  depGroupTable* table;
+  uint32_t used;
+  uint32_t tombstones;
+  uint64_t generation;
+  epochRetired* retired;
+  epochDomain readers;
+  pthread_mutex_t lock;
+  N(CellDataLoader) load;
+  void* ctx;
+} N(DepGroupCache);
+
+N(DepGroupEntry) depGroupTombstone;
+
+uint32_t depGroupSlot(const uint8_t* outPoint) {
+  uint64_t h = 0x9E3779B97F4A7C15ULL;
+  for (int i = 0; i < 4; i++) {
+    h = (h ^ *((uint64_t*)&outPoint[i * 8])) * 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 31;
+  }
+  h = (h ^ *((uint32_t*)&outPoint[32])) * 0x94D049BB133111EBULL;
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+depGroupTable* depGroupTableNew(uint32_t size) {
+  depGroupTable* t = (depGroupTable*)calloc(
+      1, sizeof(depGroupTable) + (size_t)size * sizeof(N(DepGroupEntry)*));
+  if (t != NULL) {
+    t->mask = size - 1;
+  }
+  return t;
+}
+
+bool N(DepGroupCacheInit)(N(DepGroupCache) * c, uint32_t capacity,
+                          N(CellDataLoader) load, void* ctx) {
+  memset(c, 0, sizeof(N(DepGroupCache)));
+  uint32_t size = 16;
+  while ((size < capacity * 2) && (size < (1u << 30))) {
+    size *= 2;
+  }
+  c->table = depGroupTableNew(size);
+  if (c->table == NULL) {
+    return false;
+  }
+  epochInit(&c->readers);
+  c->load = load;
+  c->ctx = ctx;
+  pthread_mutex_init(&c->lock, NULL);
+  return true;
+}
+
+void N(DepGroupCacheDestroy)(N(DepGroupCache) * c) {
+  for (uint32_t i = 0; i <= c->table->mask; i++) {
+    N(DepGroupEntry)* e = c->table->slots[i];
+    if ((e != NULL) && (e != &depGroupTombstone)) {
+      free(e);
+    }
+  }
+  free(c->table);
+  epochFree(&c->retired);
+  pthread_mutex_destroy(&c->lock);
+}
+
+/*
+ * Returns a reader slot for the calling thread, or -1 when all are taken;
+ * release it with DepGroupCacheUnregisterReader before the thread exits.
+ */
+int N(DepGroupCacheRegisterReader)(N(DepGroupCache) * c) {
+  return epochRegister(&c->readers);
+}
+
+void N(DepGroupCacheUnregisterReader)(N(DepGroupCache) * c, int reader) {
+  epochUnregister(&c->readers, reader);
+}
+
+void N(DepGroupCacheReadBegin)(N(DepGroupCache) * c, int reader) {
+  epochReadBegin(&c->readers, reader);
+}
+
+void N(DepGroupCacheReadEnd)(N(DepGroupCache) * c, int reader) {
+  epochReadEnd(&c->readers, reader);
+}
+
+N(DepGroupEntry) * depGroupFind(depGroupTable* t, const uint8_t* outPoint,
+                                uint32_t* slot) {
+  uint32_t i = depGroupSlot(outPoint) & t->mask;
+  for (uint32_t probes = 0; probes <= t->mask; probes++) {
+    N(DepGroupEntry)* e = __atomic_load_n(&t->slots[i], __ATOMIC_ACQUIRE);
+    if (e == NULL) {
+      break;
+    }
+    if ((e != &depGroupTombstone) &&
+        (memcmp(e->outPoint, outPoint, AMIC_OUTPOINT_SIZE) == 0)) {
+      if (slot) {
+        *slot = i;
+      }
+      return e;
+    }
+    i = (i + 1) & t->mask;
+  }
+  return NULL;
+}
+
+void depGroupInsert(depGroupTable* t, N(DepGroupEntry) * e,
+                    uint32_t* tombstones) {
+  uint32_t i = depGroupSlot(e->outPoint) & t->mask;
+  while ((t->slots[i] != NULL) && (t->slots[i] != &depGroupTombstone)) {
+    i = (i + 1) & t->mask;
+  }
+  if ((t->slots[i] == &depGroupTombstone) && (tombstones != NULL)) {
+    (*tombstones)--;
+  }
+  __atomic_store_n(&t->slots[i], e, __ATOMIC_RELEASE);
+}
+
+void depGroupRetire(N(DepGroupCache) * c, epochRetired* r) {
+  epochRetire(&c->readers, &c->retired, r);
+}
+
+void depGroupCollect(N(DepGroupCache) * c) {
+  epochCollect(&c->readers, &c->retired);
+}
+
+/*
+ * Publishes a tombstone-free copy of the slot table, doubled until the
+ * live entries fill at most half of it.
+ */
+bool depGroupRebuild(N(DepGroupCache) * c) {
+  depGroupTable* old = c->table;
+  uint32_t size = old->mask + 1;
+  while (((c->used + 1) * 2 > size) && (size < (1u << 30))) {
+    size *= 2;
+  }
+  depGroupTable* t = depGroupTableNew(size);
+  if (t == NULL) {
+    return false;
+  }
+  for (uint32_t i = 0; i <= old->mask; i++) {
+    N(DepGroupEntry)* e = old->slots[i];
+    if ((e != NULL) && (e != &depGroupTombstone)) {
+      depGroupInsert(t, e, NULL);
+    }
+  }
+  __atomic_store_n(&c->table, t, __ATOMIC_RELEASE);
+  c->tombstones = 0;
+  depGroupRetire(c, &old->retired);
+  return true;
+}
+
+/* Frees retired entries and tables; safe to call at any time. */
+void N(DepGroupCacheReclaim)(N(DepGroupCache) * c) {
+  pthread_mutex_lock(&c->lock);
+  depGroupCollect(c);
+  pthread_mutex_unlock(&c->lock);
+}
+
+/*
+ * Expands a dep group cell into its member out points; must be called
+ * between DepGroupCacheReadBegin and DepGroupCacheReadEnd. Hits return a
+ * view into the cached entry. On a miss the cell is loaded, verified as an
+ * OutPointFixVec and cached, unless an invalidation ran meanwhile or the
+ * table cannot grow; then the view points at the loader's data instead.
+ */
+bool N(DepGroupResolve)(N(DepGroupCache) * c, N(OutPoint) * depGroup,
+                        N(OutPointFixVec) * out) {
+  const uint8_t* key = (uint8_t*)depGroup->s.p;
+  uint64_t generation = __atomic_load_n(&c->generation, __ATOMIC_ACQUIRE);
+  depGroupTable* t = __atomic_load_n(&c->table, __ATOMIC_ACQUIRE);
+  N(DepGroupEntry)* e = depGroupFind(t, key, NULL);
+  if (e == NULL) {
+    N(Slice) data;
+    if (!c->load(c->ctx, depGroup, &data)) {
+      return false;
+    }
+    out->s = data;
+    if (!N(OutPointFixVecVerify)(out, false)) {
+      return false;
+    }
+    pthread_mutex_lock(&c->lock);
+    e = depGroupFind(c->table, key, NULL);
+    bool ok = (e == NULL) && (generation == c->generation);
+    if (ok && ((c->used + c->tombstones + 1) * 4 > (c->table->mask + 1) * 3)) {
+      ok = depGroupRebuild(c) &&
+           ((c->used + 1) * 4 <= (c->table->mask + 1) * 3);
+    }
+    if (ok) {
+      e = (N(DepGroupEntry)*)malloc(sizeof(N(DepGroupEntry)) + data.length);
+      if (e != NULL) {
+        memcpy(e->outPoint, key, AMIC_OUTPOINT_SIZE);
+        e->length = data.length;
+        memcpy(e->members, data.p, data.length);
+        depGroupInsert(c->table, e, &c->tombstones);
+        c->used++;
+      }
+    }
+    depGroupCollect(c);
+    pthread_mutex_unlock(&c->lock);
+    if (e == NULL) {
+      return true;
+    }
+  }
+  out->s.p = e->members;
+  out->s.length = e->length;
+  return true;
+}
+
+/* Must hold c->lock. */
+void depGroupInvalidate(N(DepGroupCache) * c, const uint8_t* outPoint) {
+  uint32_t slot;
+  N(DepGroupEntry)* e = depGroupFind(c->table, outPoint, &slot);
+  if (e != NULL) {
+    __atomic_store_n(&c->table->slots[slot], &depGroupTombstone,
+                     __ATOMIC_RELEASE);
+    c->used--;
+    c->tombstones++;
+    depGroupRetire(c, &e->retired);
+  }
+}
+
+/*
+ * Drops the entry for a dep group cell that has been consumed. Bumping the
+ * generation also keeps a resolve that loaded the cell before this call
+ * from caching it afterwards.
+ */
+void N(DepGroupCacheInvalidate)(N(DepGroupCache) * c, N(OutPoint) * outPoint) {
+  pthread_mutex_lock(&c->lock);
+  depGroupInvalidate(c, (uint8_t*)outPoint->s.p);
+  __atomic_store_n(&c->generation, c->generation + 1, __ATOMIC_RELEASE);
+  depGroupCollect(c);
+  pthread_mutex_unlock(&c->lock);
+}
+
+void N(DepGroupCacheInvalidateInputs)(N(DepGroupCache) * c,
+                                      N(CellInputFixVec) * inputs) {
+  uint32_t len = N(CellInputFixVecLen)(inputs);
+  pthread_mutex_lock(&c->lock);
+  for (uint32_t i = 0; i < len; i++) {
+    N(CellInput) input = N(CellInputFixVecGet)(inputs, i);
+    N(OutPoint) o = N(CellInputPreviousOutput)(&input);
+    depGroupInvalidate(c, (uint8_t*)o.s.p);
+  }
+  __atomic_store_n(&c->generation, c->generation + 1, __ATOMIC_RELEASE);
+  depGroupCollect(c);
+  pthread_mutex_unlock(&c->lock);
+}
+
+/*
+ * Calls visit for every cell a transaction depends on: code deps as they
+ * are, dep groups replaced by their members. Like DepGroupResolve, must be
+ * called between DepGroupCacheReadBegin and DepGroupCacheReadEnd.
+ */
+bool N(DepGroupExpandCellDeps)(N(DepGroupCache) * c, N(CellDepFixVec) * deps,
+                               void (*visit)(void* ctx, N(OutPoint) * o),
+                               void* ctx) {
+  uint32_t len = N(CellDepFixVecLen)(deps);
+  for (uint32_t i = 0; i < len; i++) {
+    N(CellDep) d = N(CellDepFixVecGet)(deps, i);
+    N(OutPoint) o = N(CellDepOutPoint)(&d);
+    N(DepType) t = N(CellDepDepType)(&d);
+    if (N(DepTypeValue)(&t) != AMIC_DEPGROUP) {
+      visit(ctx, &o);
+      continue;
+    }
+    N(OutPointFixVec) members;
+    if (!N(DepGroupResolve)(c, &o, &members)) {
+      return false;
+    }
+    uint32_t count = N(OutPointFixVecLen)(&members);
+    for (uint32_t j = 0; j < count; j++) {
+      N(OutPoint) m = N(OutPointFixVecGet)(&members, j);
+      visit(ctx, &m);
+    }
+  }
+  return true;
+}
+
+#undef N
+
+#endif /* AMIC_DEPGROUP_H_ */
@@ -0,0 +1,111 @@
+#ifndef AMIC_EPOCH_H_
+#define AMIC_EPOCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AMIC_EPOCH_MAX_READERS 128
+
+/* Unlinked memory waiting for every reader that might still see it. */
+typedef struct epochRetired {
+  struct epochRetired* next;
+  uint64_t epoch;
+} epochRetired;
+
+typedef struct {
+  uint64_t epoch;
+  uint32_t taken;
+} __attribute__((aligned(64))) epochReader;
+
+/*
+ * Epoch based reclamation shared by the lock-free caches. A reader
+ * announces the current epoch while it holds views, writers stamp what
+ * they unlink with a fresh epoch and free it once every announced epoch
+ * is newer. readerCount is the high water mark of taken slots, the only
+ * ones collect has to scan.
+ */
+typedef struct {
+  uint64_t epoch;
+  uint32_t readerCount;
+  epochReader readers[AMIC_EPOCH_MAX_READERS];
+} epochDomain;
+
+void epochInit(epochDomain* d) {
+  memset(d, 0, sizeof(epochDomain));
+  d->epoch = 1;
+}
+
+/* Returns a reader slot for the calling thread, or -1 when all are taken. */
+int epochRegister(epochDomain* d) {
+  for (uint32_t i = 0; i < AMIC_EPOCH_MAX_READERS; i++) {
+    uint32_t expected = 0;
+    if (__atomic_compare_exchange_n(&d->readers[i].taken, &expected, 1, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      uint32_t count = __atomic_load_n(&d->readerCount, __ATOMIC_RELAXED);
+      while ((count <= i) &&
+             (!__atomic_compare_exchange_n(&d->readerCount, &count, i + 1,
+                                           false, __ATOMIC_SEQ_CST,
+                                           __ATOMIC_RELAXED))) {
+      }
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/* Frees the slot of a reader outside any read section. */
+void epochUnregister(epochDomain* d, int reader) {
+  __atomic_store_n(&d->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&d->readers[reader].taken, 0, __ATOMIC_RELEASE);
+}
+
+void epochReadBegin(epochDomain* d, int reader) {
+  uint64_t epoch = __atomic_load_n(&d->epoch, __ATOMIC_SEQ_CST);
+  __atomic_exchange_n(&d->readers[reader].epoch, epoch, __ATOMIC_SEQ_CST);
+}
+
+void epochReadEnd(epochDomain* d, int reader) {
+  __atomic_store_n(&d->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+}
+
+/* Stamps r and pushes it on list; the caller serializes access to list. */
+void epochRetire(epochDomain* d, epochRetired** list, epochRetired* r) {
+  r->epoch = __atomic_fetch_add(&d->epoch, 1, __ATOMIC_SEQ_CST);
+  r->next = *list;
+  *list = r;
+}
+
+/* Frees retired memory on list that no active reader can still reach. */
+void epochCollect(epochDomain* d, epochRetired** list) {
+  uint64_t oldest = UINT64_MAX;
+  uint32_t readers = __atomic_load_n(&d->readerCount, __ATOMIC_SEQ_CST);
+  for (uint32_t i = 0; i < readers; i++) {
+    uint64_t e = __atomic_load_n(&d->readers[i].epoch, __ATOMIC_SEQ_CST);
+    if ((e != 0) && (e < oldest)) {
+      oldest = e;
+    }
+  }
+  epochRetired** link = list;
+  while (*link != NULL) {
+    epochRetired* r = *link;
+    if (r->epoch < oldest) {
+      *link = r->next;
+      free(r);
+    } else {
+      link = &r->next;
+    }
+  }
+}
+
+/* Frees everything on list; only once no reader is left. */
+void epochFree(epochRetired** list) {
+  while (*list != NULL) {
+    epochRetired* next = (*list)->next;
+    free(*list);
+    *list = next;
+  }
+}
+
+#endif /* AMIC_EPOCH_H_ */
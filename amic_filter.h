@@ -0,0 +1,427 @@
+#ifndef AMIC_FILTER_H_
+#define AMIC_FILTER_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/* Golomb-Rice parameters from BIP158's basic filter. */
+#define AMIC_FILTER_P 19
+#define AMIC_FILTER_M 784931
+
+/*
+ * A filter is a CompactSize item count followed by the sorted, delta and
+ * Golomb-Rice coded item values, most significant bit first. Items are
+ * the script hashes (hash of the script's Molecule bytes) of every lock
+ * and type script in the block's outputs and the cells its inputs spend,
+ * mapped into [0, count * M) by SipHash-2-4 keyed with the first 16 bytes
+ * of the block hash.
+ */
+typedef struct {
+  uint64_t k0;
+  uint64_t k1;
+} filterKey;
+
+#define FILTER_ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define FILTER_SIPROUND(v0, v1, v2, v3) \
+  do {                                  \
+    v0 += v1;                           \
+    v1 = FILTER_ROTL(v1, 13);           \
+    v1 ^= v0;                           \
+    v0 = FILTER_ROTL(v0, 32);           \
+    v2 += v3;                           \
+    v3 = FILTER_ROTL(v3, 16);           \
+    v3 ^= v2;                           \
+    v0 += v3;                           \
+    v3 = FILTER_ROTL(v3, 21);           \
+    v3 ^= v0;                           \
+    v2 += v1;                           \
+    v1 = FILTER_ROTL(v1, 17);           \
+    v1 ^= v2;                           \
+    v2 = FILTER_ROTL(v2, 32);           \
+  } while (0)
+
+/* SipHash-2-4 of a 32-byte hash. */
+uint64_t filterSipHash(const filterKey* k, const uint8_t* item) {
+  uint64_t v0 = k->k0 ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = k->k1 ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = k->k0 ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = k->k1 ^ 0x7465646279746573ULL;
+  for (int i = 0; i < 4; i++) {
+    uint64_t m = *((uint64_t*)&item[i * 8]);
+    v3 ^= m;
+    FILTER_SIPROUND(v0, v1, v2, v3);
+    FILTER_SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+  uint64_t last = (uint64_t)AMIC_HASH_SIZE << 56;
+  v3 ^= last;
+  FILTER_SIPROUND(v0, v1, v2, v3);
+  FILTER_SIPROUND(v0, v1, v2, v3);
+  v0 ^= last;
+  v2 ^= 0xff;
+  for (int i = 0; i < 4; i++) {
+    FILTER_SIPROUND(v0, v1, v2, v3);
+  }
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint64_t filterMulHigh(uint64_t a, uint64_t b) {
+  uint64_t aLo = (uint32_t)a, aHi = a >> 32;
+  uint64_t bLo = (uint32_t)b, bHi = b >> 32;
+  uint64_t lo = aLo * bLo;
+  uint64_t mid1 = aHi * bLo + (lo >> 32);
+  uint64_t mid2 = aLo * bHi + (uint32_t)mid1;
+  return aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+}
+
+filterKey filterKeyOf(const uint8_t* blockHash) {
+  filterKey k;
+  k.k0 = *((uint64_t*)&blockHash[0]);
+  k.k1 = *((uint64_t*)&blockHash[8]);
+  return k;
+}
+
+int filterCompare(const void* a, const void* b) {
+  uint64_t x = *((const uint64_t*)a);
+  uint64_t y = *((const uint64_t*)b);
+  return (x > y) - (x < y);
+}
+
+/* Sorts values and drops duplicates; returns the remaining count. */
+uint32_t filterSortUnique(uint64_t* values, uint32_t count) {
+  qsort(values, count, sizeof(uint64_t), filterCompare);
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if ((n == 0) || (values[n - 1] != values[i])) {
+      values[n++] = values[i];
+    }
+  }
+  return n;
+}
+
+typedef struct {
+  uint8_t* p;
+  uint64_t acc;
+  int bits;
+} filterWriter;
+
+void filterWriteBits(filterWriter* w, uint64_t value, int bits) {
+  while (bits > 0) {
+    int n = (bits < 56 - w->bits) ? bits : 56 - w->bits;
+    bits -= n;
+    w->acc = (w->acc << n) | ((value >> bits) & ((1ULL << n) - 1));
+    w->bits += n;
+    while (w->bits >= 8) {
+      w->bits -= 8;
+      *w->p++ = (uint8_t)(w->acc >> w->bits);
+    }
+  }
+}
+
+void filterWriteUnary(filterWriter* w, uint64_t q) {
+  for (; q >= 32; q -= 32) {
+    filterWriteBits(w, 0xffffffffULL, 32);
+  }
+  filterWriteBits(w, ((1ULL << q) - 1) << 1, (int)q + 1);
+}
+
+uint8_t* filterWriteCompactSize(uint8_t* p, uint64_t n) {
+  if (n < 0xfd) {
+    *p++ = (uint8_t)n;
+  } else if (n <= 0xffff) {
+    *p++ = 0xfd;
+    *p++ = (uint8_t)n;
+    *p++ = (uint8_t)(n >> 8);
+  } else {
+    *p++ = 0xfe;
+    for (int i = 0; i < 4; i++) {
+      *p++ = (uint8_t)(n >> (i * 8));
+    }
+  }
+  return p;
+}
+
+bool filterReadCompactSize(const uint8_t** p, const uint8_t* end,
+                           uint32_t* n) {
+  if (*p >= end) {
+    return false;
+  }
+  uint8_t tag = *(*p)++;
+  int bytes = (tag == 0xfd) ? 2 : (tag == 0xfe) ? 4 : 0;
+  if (tag == 0xff) {
+    return false;
+  }
+  if (bytes == 0) {
+    *n = tag;
+    return true;
+  }
+  if (end - *p < bytes) {
+    return false;
+  }
+  *n = 0;
+  for (int i = 0; i < bytes; i++) {
+    *n |= (uint32_t)(*(*p)++) << (i * 8);
+  }
+  return true;
+}
+
+int filterCompareHash(const void* a, const void* b) {
+  return memcmp(a, b, AMIC_HASH_SIZE);
+}
+
+void filterCollect(N(CellOutput) * o, N(Hasher) * h, uint8_t* hashes,
+                   uint32_t* count) {
+  N(Script) lock = N(CellOutputLock)(o);
+  N(HasherHash)(h, lock.s.p, lock.s.length,
+                &hashes[(*count)++ * AMIC_HASH_SIZE]);
+  if (N(CellOutputHasType)(o)) {
+    N(Script) type = N(CellOutputType)(o);
+    N(HasherHash)(h, type.s.p, type.s.length,
+                  &hashes[(*count)++ * AMIC_HASH_SIZE]);
+  }
+}
+
+/*
+ * Builds the filter of a verified block and appends it to out.
+ * resolvedInputs holds the cells spent by every non-cellbase input, in
+ * block order.
+ */
+bool N(FilterBuild)(N(Block) * b, N(CellOutput) * resolvedInputs,
+                    uint32_t resolvedCount, N(Hasher) * h, N(Buffer) * out,
+                    N(Slice) * filter) {
+  N(Header) header = N(BlockHeader)(b);
+  uint8_t blockHash[AMIC_HASH_SIZE];
+  N(HasherHash)(h, header.s.p, header.s.length, blockHash);
+  filterKey k = filterKeyOf(blockHash);
+  N(TransactionDynVec) txs = N(BlockTransactions)(b);
+  uint32_t txCount = N(TransactionDynVecLen)(&txs);
+  uint64_t items = (uint64_t)resolvedCount * 2;
+  for (uint32_t i = 0; i < txCount; i++) {
+    N(Transaction) tx = N(TransactionDynVecGet)(&txs, i);
+    N(RawTransaction) raw = N(TransactionRaw)(&tx);
+    N(CellOutputDynVec) outputs = N(RawTransactionOutputs)(&raw);
+    items += (uint64_t)N(CellOutputDynVecLen)(&outputs) * 2;
+  }
+  if (items > UINT32_MAX / AMIC_HASH_SIZE) {
+    return false;
+  }
+  uint8_t* hashes = (uint8_t*)malloc((items + 1) * AMIC_HASH_SIZE);
+  if (hashes == NULL) {
+    return false;
+  }
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < txCount; i++) {
+    N(Transaction) tx = N(TransactionDynVecGet)(&txs, i);
+    N(RawTransaction) raw = N(TransactionRaw)(&tx);
+    N(CellOutputDynVec) outputs = N(RawTransactionOutputs)(&raw);
+    uint32_t outputCount = N(CellOutputDynVecLen)(&outputs);
+    for (uint32_t j = 0; j < outputCount; j++) {
+      N(CellOutput) o = N(CellOutputDynVecGet)(&outputs, j);
+      filterCollect(&o, h, hashes, &count);
+    }
+  }
+  for (uint32_t i = 0; i < resolvedCount; i++) {
+    filterCollect(&resolvedInputs[i], h, hashes, &count);
+  }
+  /* Values are written over the sorted hashes they came from. */
+  qsort(hashes, count, AMIC_HASH_SIZE, filterCompareHash);
+  uint64_t* values = (uint64_t*)hashes;
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t* hash = &hashes[i * AMIC_HASH_SIZE];
+    if ((n == 0) ||
+        (memcmp(&hashes[(n - 1) * AMIC_HASH_SIZE], hash, AMIC_HASH_SIZE))) {
+      memmove(&hashes[n++ * AMIC_HASH_SIZE], hash, AMIC_HASH_SIZE);
+    }
+  }
+  uint64_t range = (uint64_t)n * AMIC_FILTER_M;
+  for (uint32_t i = 0; i < n; i++) {
+    values[i] = filterMulHigh(
+        filterSipHash(&k, &hashes[i * AMIC_HASH_SIZE]), range);
+  }
+  qsort(values, n, sizeof(uint64_t), filterCompare);
+  /* Quotients sum to at most range >> P over the whole set. */
+  uint64_t bound = 5 + ((uint64_t)n * (AMIC_FILTER_P + 1) +
+                        (range >> AMIC_FILTER_P) + 64) / 8;
+  if ((bound > UINT32_MAX) || (!N(BufferReserve)(out, (uint32_t)bound))) {
+    free(hashes);
+    return false;
+  }
+  uint8_t* start = &out->p[out->length];
+  filterWriter w;
+  w.p = filterWriteCompactSize(start, n);
+  w.acc = 0;
+  w.bits = 0;
+  uint64_t last = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    uint64_t delta = values[i] - last;
+    last = values[i];
+    filterWriteUnary(&w, delta >> AMIC_FILTER_P);
+    filterWriteBits(&w, delta, AMIC_FILTER_P);
+  }
+  if (w.bits > 0) {
+    *w.p++ = (uint8_t)(w.acc << (8 - w.bits));
+  }
+  free(hashes);
+  filter->p = start;
+  filter->length = (uint32_t)(w.p - start);
+  out->length += filter->length;
+  return true;
+}
+
+/*
+ * Reads the coded stream through a 64-bit window so a unary quotient is a
+ * single count-leading-zeros in the common case.
+ */
+typedef struct {
+  const uint8_t* p;
+  const uint8_t* end;
+  uint64_t window;
+  int bits;
+} filterReader;
+
+void filterRefill(filterReader* r) {
+  while ((r->bits <= 56) && (r->p < r->end)) {
+    r->window |= (uint64_t)(*r->p++) << (56 - r->bits);
+    r->bits += 8;
+  }
+}
+
+bool filterReadDelta(filterReader* r, uint64_t* delta) {
+  uint64_t q = 0;
+  while (true) {
+    filterRefill(r);
+    if (r->bits == 0) {
+      return false;
+    }
+    uint64_t inverted = ~r->window;
+    int ones = (inverted == 0) ? 64 : __builtin_clzll(inverted);
+    if (ones < r->bits) {
+      q += ones;
+      r->window = (r->window << ones) << 1;
+      r->bits -= ones + 1;
+      break;
+    }
+    q += r->bits;
+    r->window = 0;
+    r->bits = 0;
+  }
+  filterRefill(r);
+  if (r->bits < AMIC_FILTER_P) {
+    return false;
+  }
+  *delta = (q << AMIC_FILTER_P) | (r->window >> (64 - AMIC_FILTER_P));
+  r->window <<= AMIC_FILTER_P;
+  r->bits -= AMIC_FILTER_P;
+  return true;
+}
+
+typedef struct {
+  const uint8_t* blockHash;
+  N(Slice) filter;
+} N(FilterRef);
+
+/*
+ * True when any of the 32-byte script hashes in queries may be in the
+ * filter. The queries are mapped and sorted once, then merged against a
+ * single decoding pass. scratch must hold queryCount values.
+ */
+bool N(FilterMatchAny)(N(FilterRef) * f, const uint8_t* queries,
+                       uint32_t queryCount, uint64_t* scratch) {
+  const uint8_t* p = (const uint8_t*)f->filter.p;
+  const uint8_t* end = p + f->filter.length;
+  uint32_t n;
+  if ((!filterReadCompactSize(&p, end, &n)) || (n == 0) ||
+      (queryCount == 0)) {
+    return false;
+  }
+  filterKey k = filterKeyOf(f->blockHash);
+  uint64_t range = (uint64_t)n * AMIC_FILTER_M;
+  for (uint32_t i = 0; i < queryCount; i++) {
+    scratch[i] = filterMulHigh(
+        filterSipHash(&k, &queries[i * AMIC_HASH_SIZE]), range);
+  }
+  uint32_t q = filterSortUnique(scratch, queryCount);
+  filterReader r;
+  r.p = p;
+  r.end = end;
+  r.window = 0;
+  r.bits = 0;
+  uint64_t value = 0;
+  uint32_t j = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    uint64_t delta;
+    if (!filterReadDelta(&r, &delta)) {
+      return false;
+    }
+    value += delta;
+    while ((j < q) && (scratch[j] < value)) {
+      j++;
+    }
+    if (j == q) {
+      return false;
+    }
+    if (scratch[j] == value) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Sets bit i of matched for every filter that may contain one of the
+ * queries. Typical for wallet rescans: few queries, many blocks.
+ */
+void N(FilterMatchBatch)(N(FilterRef) * filters, uint32_t filterCount,
+                         const uint8_t* queries, uint32_t queryCount,
+                         uint64_t* scratch, uint64_t* matched) {
+  memset(matched, 0, ((filterCount + 63) / 64) * sizeof(uint64_t));
+  for (uint32_t i = 0; i < filterCount; i++) {
+    if (N(FilterMatchAny)(&filters[i], queries, queryCount, scratch)) {
+      matched[i / 64] |= 1ULL << (i % 64);
+    }
+  }
+}
+
+void N(FilterHash)(N(Hasher) * h, N(Slice) * filter, uint8_t* out) {
+  N(HasherHash)(h, filter->p, filter->length, out);
+}
+
+/* header = H(filter_hash || previous_header) */
+void N(FilterHeader)(N(Hasher) * h, const uint8_t* filterHash,
+                     const uint8_t* prevHeader, uint8_t* out) {
+  h->init(h->ctx);
+  h->update(h->ctx, filterHash, AMIC_HASH_SIZE);
+  h->update(h->ctx, prevHeader, AMIC_HASH_SIZE);
+  h->final(h->ctx, out);
+}
+
+/*
+ * Filter headers are stored on disk as the header preceding a run followed
+ * by one filter hash per block, half the size of storing both. This
+ * rebuilds the count headers of a run into headers.
+ */
+void N(FilterHeadersRebuild)(N(Hasher) * h, const uint8_t* prevHeader,
+                             const uint8_t* filterHashes, uint32_t count,
+                             uint8_t* headers) {
+  for (uint32_t i = 0; i < count; i++) {
+    N(FilterHeader)(h, &filterHashes[i * AMIC_HASH_SIZE], prevHeader,
+                    &headers[i * AMIC_HASH_SIZE]);
+    prevHeader = &headers[i * AMIC_HASH_SIZE];
+  }
+}
+
+#undef FILTER_SIPROUND
+#undef FILTER_ROTL
+#undef N
+
+#endif /* AMIC_FILTER_H_ */
@@ -0,0 +1,200 @@
+#ifndef AMIC_GROUP_H_
+#define AMIC_GROUP_H_
+
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+#define AMIC_GROUP_LOCK 0
+#define AMIC_GROUP_TYPE 1
+
+typedef struct {
+  uint8_t hash[AMIC_HASH_SIZE];
+  N(Script) script;
+  uint8_t kind;
+  uint32_t* inputs;
+  uint32_t inputCount;
+  uint32_t* outputs;
+  uint32_t outputCount;
+} N(ScriptGroup);
+
+typedef struct {
+  N(ScriptGroup) * groups;
+  uint32_t count;
+} N(ScriptGroups);
+
+typedef struct {
+  N(Script) script;
+  uint32_t lockInputs;
+  uint32_t typeInputs;
+  uint32_t typeOutputs;
+  uint32_t lockGroup;
+  uint32_t typeGroup;
+} groupScript;
+
+uint64_t groupFingerprint(const uint8_t* p, uint32_t len) {
+  uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    h = (h ^ *((uint64_t*)&p[i])) * 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 31;
+  }
+  for (; i < len; i++) {
+    h = (h ^ p[i]) * 0x94D049BB133111EBULL;
+  }
+  return h ^ (h >> 29);
+}
+
+/*
+ * Open addressing over distinct script byte ranges; slots hold 1-based
+ * indices into scripts.
+ */
+uint32_t groupIntern(uint32_t* slots, uint32_t mask, groupScript* scripts,
+                     uint32_t* count, N(Script) * s) {
+  uint32_t i = (uint32_t)groupFingerprint((uint8_t*)s->s.p, s->s.length) & mask;
+  while (slots[i] != 0) {
+    groupScript* g = &scripts[slots[i] - 1];
+    if ((g->script.s.length == s->s.length) &&
+        (memcmp(g->script.s.p, s->s.p, s->s.length) == 0)) {
+      return slots[i] - 1;
+    }
+    i = (i + 1) & mask;
+  }
+  groupScript* g = &scripts[*count];
+  g->script = *s;
+  g->lockInputs = g->typeInputs = g->typeOutputs = 0;
+  slots[i] = ++(*count);
+  return *count - 1;
+}
+
+void* groupCarve(uint8_t** cursor, uint32_t size) {
+  uintptr_t p = ((uintptr_t)*cursor + 7) & ~(uintptr_t)7;
+  *cursor = (uint8_t*)(p + size);
+  return (void*)p;
+}
+
+/*
+ * Partitions a verified transaction into lock groups (inputs only) and type
+ * groups (inputs and outputs). resolvedInputs holds the cell each input
+ * spends, in input order. Identical script bytes are merged before hashing,
+ * so each distinct script is hashed once no matter how many cells use it
+ * or in which role. All results live in the arena, which is grown once up
+ * front; the views stay valid until the caller resets it.
+ */
+bool N(ScriptGroupsBuild)(N(RawTransaction) * tx,
+                          N(CellOutput) * resolvedInputs, N(Hasher) * hasher,
+                          N(Buffer) * arena, N(ScriptGroups) * out) {
+  N(CellInputFixVec) inputs = N(RawTransactionInputs)(tx);
+  N(CellOutputDynVec) outputs = N(RawTransactionOutputs)(tx);
+  uint32_t inputCount = N(CellInputFixVecLen)(&inputs);
+  uint32_t outputCount = N(CellOutputDynVecLen)(&outputs);
+  uint64_t occurrences = (uint64_t)inputCount * 2 + outputCount;
+  uint64_t capacity = 16;
+  while (capacity < occurrences * 2) {
+    capacity *= 2;
+  }
+  uint64_t bytes = capacity * 4 + occurrences * 4 +
+                   occurrences * sizeof(groupScript) +
+                   occurrences * sizeof(N(ScriptGroup)) + occurrences * 4 + 64;
+  if ((bytes > UINT32_MAX) || (!N(BufferReserve)(arena, (uint32_t)bytes))) {
+    return false;
+  }
+  uint8_t* cursor = &arena->p[arena->length];
+  uint32_t* slots = (uint32_t*)groupCarve(&cursor, capacity * 4);
+  uint32_t* occ = (uint32_t*)groupCarve(&cursor, occurrences * 4);
+  groupScript* scripts =
+      (groupScript*)groupCarve(&cursor, occurrences * sizeof(groupScript));
+  memset(slots, 0, capacity * 4);
+  uint32_t mask = (uint32_t)capacity - 1;
+  uint32_t scriptCount = 0;
+  uint32_t k = 0;
+
+  for (uint32_t i = 0; i < inputCount; i++) {
+    N(Script) lock = N(CellOutputLock)(&resolvedInputs[i]);
+    occ[k] = groupIntern(slots, mask, scripts, &scriptCount, &lock);
+    scripts[occ[k++]].lockInputs++;
+    if (N(CellOutputHasType)(&resolvedInputs[i])) {
+      N(Script) type = N(CellOutputType)(&resolvedInputs[i]);
+      occ[k] = groupIntern(slots, mask, scripts, &scriptCount, &type);
+      scripts[occ[k++]].typeInputs++;
+    }
+  }
+  for (uint32_t i = 0; i < outputCount; i++) {
+    N(CellOutput) o = N(CellOutputDynVecGet)(&outputs, i);
+    if (N(CellOutputHasType)(&o)) {
+      N(Script) type = N(CellOutputType)(&o);
+      occ[k] = groupIntern(slots, mask, scripts, &scriptCount, &type);
+      scripts[occ[k++]].typeOutputs++;
+    }
+  }
+
+  uint32_t groupCount = 0;
+  for (uint32_t i = 0; i < scriptCount; i++) {
+    groupCount += (scripts[i].lockInputs > 0) +
+                  (scripts[i].typeInputs + scripts[i].typeOutputs > 0);
+  }
+  N(ScriptGroup)* groups = (N(ScriptGroup)*)groupCarve(
+      &cursor, groupCount * sizeof(N(ScriptGroup)));
+  uint32_t* indices = (uint32_t*)groupCarve(&cursor, k * 4);
+  uint32_t g = 0;
+  for (int kind = AMIC_GROUP_LOCK; kind <= AMIC_GROUP_TYPE; kind++) {
+    for (uint32_t i = 0; i < scriptCount; i++) {
+      groupScript* s = &scripts[i];
+      uint32_t in = (kind == AMIC_GROUP_LOCK) ? s->lockInputs : s->typeInputs;
+      uint32_t outCount = (kind == AMIC_GROUP_LOCK) ? 0 : s->typeOutputs;
+      if (in + outCount == 0) {
+        continue;
+      }
+      N(ScriptGroup)* group = &groups[g];
+      group->script = s->script;
+      group->kind = (uint8_t)kind;
+      group->inputs = indices;
+      group->outputs = indices + in;
+      group->inputCount = group->outputCount = 0;
+      indices += in + outCount;
+      if (kind == AMIC_GROUP_LOCK) {
+        s->lockGroup = g;
+      } else {
+        s->typeGroup = g;
+      }
+      if ((kind == AMIC_GROUP_TYPE) && (s->lockInputs > 0)) {
+        memcpy(group->hash, groups[s->lockGroup].hash, AMIC_HASH_SIZE);
+      } else {
+        N(HasherHash)(hasher, s->script.s.p, s->script.s.length, group->hash);
+      }
+      g++;
+    }
+  }
+
+  k = 0;
+  for (uint32_t i = 0; i < inputCount; i++) {
+    N(ScriptGroup)* lockGroup = &groups[scripts[occ[k++]].lockGroup];
+    lockGroup->inputs[lockGroup->inputCount++] = i;
+    if (N(CellOutputHasType)(&resolvedInputs[i])) {
+      N(ScriptGroup)* typeGroup = &groups[scripts[occ[k++]].typeGroup];
+      typeGroup->inputs[typeGroup->inputCount++] = i;
+    }
+  }
+  for (uint32_t i = 0; i < outputCount; i++) {
+    N(CellOutput) o = N(CellOutputDynVecGet)(&outputs, i);
+    if (N(CellOutputHasType)(&o)) {
+      N(ScriptGroup)* typeGroup = &groups[scripts[occ[k++]].typeGroup];
+      typeGroup->outputs[typeGroup->outputCount++] = i;
+    }
+  }
+
+  arena->length = (uint32_t)(cursor - arena->p);
+  out->groups = groups;
+  out->count = groupCount;
+  return true;
+}
+
+#undef N
+
+#endif /* AMIC_GROUP_H_ */
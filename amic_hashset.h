@@ -0,0 +1,104 @@
+#ifndef AMIC_HASHSET_H_
+#define AMIC_HASHSET_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+
+/* Largest entry count a set can hold while staying at most half full. */
+#define AMIC_HASHSET_MAX (1u << 29)
+
+/*
+ * Returns the 32 byte hash a nonzero slot value stands for. Slots hold
+ * caller defined refs plus one, zero marks an empty slot.
+ */
+typedef const uint8_t* (*hashSetKey)(void* ctx, uint32_t slot);
+
+/*
+ * Linear probing set over hashes that live elsewhere, homed by their first
+ * four bytes. The owner keeps it at most half full, so probes stay short
+ * and every probe sequence ends at an empty slot.
+ */
+typedef struct {
+  uint32_t* slots;
+  uint32_t mask;
+} hashSet;
+
+/* Sizes the set for capacity entries; fails above AMIC_HASHSET_MAX. */
+bool hashSetInit(hashSet* s, uint32_t capacity) {
+  if (capacity > AMIC_HASHSET_MAX) {
+    return false;
+  }
+  uint32_t size = 16;
+  while (size < capacity * 2) {
+    size *= 2;
+  }
+  s->slots = (uint32_t*)calloc(size, sizeof(uint32_t));
+  s->mask = size - 1;
+  return s->slots != NULL;
+}
+
+void hashSetDestroy(hashSet* s) { free(s->slots); }
+
+uint32_t hashSetHome(const hashSet* s, const uint8_t* hash) {
+  return *((uint32_t*)hash) & s->mask;
+}
+
+/* Returns the slot holding hash, or the empty slot ending its probes. */
+uint32_t hashSetFind(const hashSet* s, const uint8_t* hash, hashSetKey key,
+                     void* ctx) {
+  uint32_t i = hashSetHome(s, hash);
+  while ((s->slots[i] != 0) &&
+         (memcmp(key(ctx, s->slots[i]), hash, AMIC_HASH_SIZE) != 0)) {
+    i = (i + 1) & s->mask;
+  }
+  return i;
+}
+
+/* Backward shift deletion keeps probe sequences intact without tombstones. */
+void hashSetErase(hashSet* s, uint32_t i, hashSetKey key, void* ctx) {
+  uint32_t j = i;
+  while (true) {
+    j = (j + 1) & s->mask;
+    if (s->slots[j] == 0) {
+      break;
+    }
+    uint32_t home = hashSetHome(s, key(ctx, s->slots[j]));
+    if (((j - home) & s->mask) >= ((j - i) & s->mask)) {
+      s->slots[i] = s->slots[j];
+      i = j;
+    }
+  }
+  s->slots[i] = 0;
+}
+
+/*
+ * Doubles the slot table until count entries fit at most half full. Fails,
+ * leaving the set as it was, above AMIC_HASHSET_MAX or out of memory.
+ */
+bool hashSetReserve(hashSet* s, uint32_t count, hashSetKey key, void* ctx) {
+  if ((uint64_t)count * 2 <= (uint64_t)s->mask + 1) {
+    return true;
+  }
+  if (count > AMIC_HASHSET_MAX) {
+    return false;
+  }
+  hashSet old = *s;
+  if (!hashSetInit(s, count)) {
+    *s = old;
+    return false;
+  }
+  for (uint32_t i = 0; i <= old.mask; i++) {
+    if (old.slots[i] != 0) {
+      s->slots[hashSetFind(s, key(ctx, old.slots[i]), key, ctx)] =
+          old.slots[i];
+    }
+  }
+  hashSetDestroy(&old);
+  return true;
+}
+
+#endif /* AMIC_HASHSET_H_ */
@@ -0,0 +1,1023 @@
+#ifndef AMIC_JSON_H_
+#define AMIC_JSON_H_
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/*
+ * Writers for the CKB RPC JSON representation. Input views must already
+ * have passed the matching *Verify call. Each writer appends to the buffer
+ * and returns false only when the buffer cannot grow.
+ */
+
+const char jsonHexDigits[] = "0123456789abcdef";
+
+uint64_t jsonHexSpread(uint32_t v) {
+  uint64_t x = v;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+  uint64_t n = ((x >> 4) & 0x000F000F000F000FULL) |
+               ((x & 0x000F000F000F000FULL) << 8);
+  uint64_t letters = ((n + 0x0606060606060606ULL) >> 4) & 0x0101010101010101ULL;
+  return n + 0x3030303030303030ULL + letters * 0x27;
+}
+
+void jsonHexEncode(uint8_t* dst, const uint8_t* src, uint32_t len) {
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    ((uint64_t*)&dst[i * 2])[0] = jsonHexSpread(*((uint32_t*)&src[i]));
+    ((uint64_t*)&dst[i * 2])[1] = jsonHexSpread(*((uint32_t*)&src[i + 4]));
+  }
+  for (; i < len; i++) {
+    dst[i * 2] = jsonHexDigits[src[i] >> 4];
+    dst[i * 2 + 1] = jsonHexDigits[src[i] & 0xF];
+  }
+}
+
+bool jsonPut(N(Buffer) * b, const char* s, uint32_t len) {
+  if (!N(BufferReserve)(b, len)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < len; i++) {
+    b->p[b->length + i] = (uint8_t)s[i];
+  }
+  b->length += len;
+  return true;
+}
+
+#define jsonLiteral(b, s) jsonPut(b, s, sizeof(s) - 1)
+
+bool jsonHexBytes(N(Buffer) * b, const void* p, uint32_t len) {
+  if ((len > (UINT32_MAX - 4) / 2) || (!N(BufferReserve)(b, len * 2 + 4))) {
+    return false;
+  }
+  uint8_t* dst = &b->p[b->length];
+  dst[0] = '"';
+  dst[1] = '0';
+  dst[2] = 'x';
+  jsonHexEncode(&dst[3], (const uint8_t*)p, len);
+  dst[len * 2 + 3] = '"';
+  b->length += len * 2 + 4;
+  return true;
+}
+
+bool jsonHexDigitsOf(N(Buffer) * b, uint64_t v, int digits) {
+  if (!N(BufferReserve)(b, (uint32_t)digits)) {
+    return false;
+  }
+  uint8_t* dst = &b->p[b->length];
+  for (int i = digits - 1; i >= 0; i--) {
+    dst[i] = jsonHexDigits[v & 0xF];
+    v >>= 4;
+  }
+  b->length += (uint32_t)digits;
+  return true;
+}
+
+int jsonHexDigitCount(uint64_t v) {
+  return (v == 0) ? 1 : (64 - __builtin_clzll(v) + 3) / 4;
+}
+
+bool jsonHexUint(N(Buffer) * b, uint64_t v) {
+  return jsonLiteral(b, "\"0x") &&
+         jsonHexDigitsOf(b, v, jsonHexDigitCount(v)) && jsonLiteral(b, "\"");
+}
+
+bool jsonHexUint128(N(Buffer) * b, const uint8_t* le) {
+  uint64_t lo = ((uint64_t*)le)[0];
+  uint64_t hi = ((uint64_t*)le)[1];
+  if (hi == 0) {
+    return jsonHexUint(b, lo);
+  }
+  return jsonLiteral(b, "\"0x") &&
+         jsonHexDigitsOf(b, hi, jsonHexDigitCount(hi)) &&
+         jsonHexDigitsOf(b, lo, 16) && jsonLiteral(b, "\"");
+}
+
+bool jsonHash(N(Buffer) * b, N(Hash) * h) {
+  return jsonHexBytes(b, h->s.p, h->s.length);
+}
+
+bool jsonBytes(N(Buffer) * b, N(Bytes) * p) {
+  uint32_t len;
+  void* data = N(BytesValue)(p, &len);
+  return jsonHexBytes(b, data, len);
+}
+
+bool N(JsonWriteScript)(N(Buffer) * b, N(Script) * s) {
+  N(Hash) codeHash = N(ScriptCodeHash)(s);
+  N(ScriptHashType) hashType = N(ScriptScriptHashType)(s);
+  N(Bytes) args = N(ScriptArgs)(s);
+  return jsonLiteral(b, "{\"code_hash\":") && jsonHash(b, &codeHash) &&
+         ((N(ScriptHashTypeValue)(&hashType) == AMIC_TYPE)
+              ? jsonLiteral(b, ",\"hash_type\":\"type\",\"args\":")
+              : jsonLiteral(b, ",\"hash_type\":\"data\",\"args\":")) &&
+         jsonBytes(b, &args) && jsonLiteral(b, "}");
+}
+
+bool N(JsonWriteOutPoint)(N(Buffer) * b, N(OutPoint) * o) {
+  N(Hash) txHash = N(OutPointTxHash)(o);
+  return jsonLiteral(b, "{\"tx_hash\":") && jsonHash(b, &txHash) &&
+         jsonLiteral(b, ",\"index\":") &&
+         jsonHexUint(b, N(OutPointIndex)(o)) && jsonLiteral(b, "}");
+}
+
+bool N(JsonWriteCellDep)(N(Buffer) * b, N(CellDep) * d) {
+  N(OutPoint) o = N(CellDepOutPoint)(d);
+  N(DepType) t = N(CellDepDepType)(d);
+  return jsonLiteral(b, "{\"out_point\":") && N(JsonWriteOutPoint)(b, &o) &&
+         ((N(DepTypeValue)(&t) == AMIC_DEPGROUP)
+              ? jsonLiteral(b, ",\"dep_type\":\"dep_group\"}")
+              : jsonLiteral(b, ",\"dep_type\":\"code\"}"));
+}
+
+bool N(JsonWriteCellInput)(N(Buffer) * b, N(CellInput) * i) {
+  N(OutPoint) o = N(CellInputPreviousOutput)(i);
+  return jsonLiteral(b, "{\"since\":") &&
+         jsonHexUint(b, N(CellInputSince)(i)) &&
+         jsonLiteral(b, ",\"previous_output\":") &&
+         N(JsonWriteOutPoint)(b, &o) && jsonLiteral(b, "}");
+}
+
+bool N(JsonWriteCellOutput)(N(Buffer) * b, N(CellOutput) * o) {
+  N(Script) lock = N(CellOutputLock)(o);
+  if (!(jsonLiteral(b, "{\"capacity\":") &&
+        jsonHexUint(b, N(CellOutputCapacity)(o)) &&
+        jsonLiteral(b, ",\"lock\":") && N(JsonWriteScript)(b, &lock) &&
+        jsonLiteral(b, ",\"type\":"))) {
+    return false;
+  }
+  if (N(CellOutputHasType)(o)) {
+    N(Script) type = N(CellOutputType)(o);
+    if (!N(JsonWriteScript)(b, &type)) {
+      return false;
+    }
+  } else if (!jsonLiteral(b, "null")) {
+    return false;
+  }
+  return jsonLiteral(b, "}");
+}
+
+bool jsonBytesDynVec(N(Buffer) * b, N(BytesDynVec) * v) {
+  uint32_t len = N(BytesDynVecLen)(v);
+  if (!jsonLiteral(b, "[")) {
+    return false;
+  }
+  for (uint32_t i = 0; i < len; i++) {
+    N(Bytes) item = N(BytesDynVecGet)(v, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) || (!jsonBytes(b, &item))) {
+      return false;
+    }
+  }
+  return jsonLiteral(b, "]");
+}
+
+bool N(JsonWriteRawTransaction)(N(Buffer) * b, N(RawTransaction) * t) {
+  if (!(jsonLiteral(b, "\"version\":") &&
+        jsonHexUint(b, N(RawTransactionVersion)(t)) &&
+        jsonLiteral(b, ",\"cell_deps\":["))) {
+    return false;
+  }
+  N(CellDepFixVec) deps = N(RawTransactionCellDeps)(t);
+  uint32_t len = N(CellDepFixVecLen)(&deps);
+  for (uint32_t i = 0; i < len; i++) {
+    N(CellDep) d = N(CellDepFixVecGet)(&deps, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) || (!N(JsonWriteCellDep)(b, &d))) {
+      return false;
+    }
+  }
+  if (!jsonLiteral(b, "],\"header_deps\":[")) {
+    return false;
+  }
+  N(HashFixVec) headerDeps = N(RawTransactionHeaderDeps)(t);
+  len = N(HashFixVecLen)(&headerDeps);
+  for (uint32_t i = 0; i < len; i++) {
+    N(Hash) h = N(HashFixVecGet)(&headerDeps, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) || (!jsonHash(b, &h))) {
+      return false;
+    }
+  }
+  if (!jsonLiteral(b, "],\"inputs\":[")) {
+    return false;
+  }
+  N(CellInputFixVec) inputs = N(RawTransactionInputs)(t);
+  len = N(CellInputFixVecLen)(&inputs);
+  for (uint32_t i = 0; i < len; i++) {
+    N(CellInput) input = N(CellInputFixVecGet)(&inputs, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) ||
+        (!N(JsonWriteCellInput)(b, &input))) {
+      return false;
+    }
+  }
+  if (!jsonLiteral(b, "],\"outputs\":[")) {
+    return false;
+  }
+  N(CellOutputDynVec) outputs = N(RawTransactionOutputs)(t);
+  len = N(CellOutputDynVecLen)(&outputs);
+  for (uint32_t i = 0; i < len; i++) {
+    N(CellOutput) output = N(CellOutputDynVecGet)(&outputs, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) ||
+        (!N(JsonWriteCellOutput)(b, &output))) {
+      return false;
+    }
+  }
+  N(BytesDynVec) outputsData = N(RawTransactionOutputsData)(t);
+  return jsonLiteral(b, "],\"outputs_data\":") &&
+         jsonBytesDynVec(b, &outputsData);
+}
+
+bool N(JsonWriteTransaction)(N(Buffer) * b, N(Transaction) * t) {
+  N(RawTransaction) raw = N(TransactionRaw)(t);
+  N(BytesDynVec) witnesses = N(TransactionWitnesses)(t);
+  return jsonLiteral(b, "{") && N(JsonWriteRawTransaction)(b, &raw) &&
+         jsonLiteral(b, ",\"witnesses\":") && jsonBytesDynVec(b, &witnesses) &&
+         jsonLiteral(b, "}");
+}
+
+bool N(JsonWriteHeader)(N(Buffer) * b, N(Header) * h) {
+  N(RawHeader) r = N(HeaderRawHeader)(h);
+  N(Hash) parentHash = N(RawHeaderParentHash)(&r);
+  N(Hash) transactionsRoot = N(RawHeaderTransactionsRoot)(&r);
+  N(Hash) proposalsHash = N(RawHeaderProposalsHash)(&r);
+  N(Hash) unclesHash = N(RawHeaderUnclesHash)(&r);
+  N(Byte32) dao = N(RawHeaderDao)(&r);
+  N(Uint128) nonce = N(HeaderNonce)(h);
+  return jsonLiteral(b, "{\"version\":") &&
+         jsonHexUint(b, N(RawHeaderVersion)(&r)) &&
+         jsonLiteral(b, ",\"compact_target\":") &&
+         jsonHexUint(b, N(RawHeaderCompactTarget)(&r)) &&
+         jsonLiteral(b, ",\"timestamp\":") &&
+         jsonHexUint(b, N(RawHeaderTimestamp)(&r)) &&
+         jsonLiteral(b, ",\"number\":") &&
+         jsonHexUint(b, N(RawHeaderNumber)(&r)) &&
+         jsonLiteral(b, ",\"epoch\":") &&
+         jsonHexUint(b, N(RawHeaderEpoch)(&r)) &&
+         jsonLiteral(b, ",\"parent_hash\":") && jsonHash(b, &parentHash) &&
+         jsonLiteral(b, ",\"transactions_root\":") &&
+         jsonHash(b, &transactionsRoot) &&
+         jsonLiteral(b, ",\"proposals_hash\":") &&
+         jsonHash(b, &proposalsHash) &&
+         jsonLiteral(b, ",\"uncles_hash\":") && jsonHash(b, &unclesHash) &&
+         jsonLiteral(b, ",\"dao\":") &&
+         jsonHexBytes(b, dao.s.p, dao.s.length) &&
+         jsonLiteral(b, ",\"nonce\":") &&
+         jsonHexUint128(b, (const uint8_t*)nonce.s.p) && jsonLiteral(b, "}");
+}
+
+bool jsonProposals(N(Buffer) * b, N(ProposalShortIdFixVec) * v) {
+  uint32_t len = N(ProposalShortIdFixVecLen)(v);
+  if (!jsonLiteral(b, "[")) {
+    return false;
+  }
+  for (uint32_t i = 0; i < len; i++) {
+    N(ProposalShortId) id = N(ProposalShortIdFixVecGet)(v, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) ||
+        (!jsonHexBytes(b, id.s.p, id.s.length))) {
+      return false;
+    }
+  }
+  return jsonLiteral(b, "]");
+}
+
+bool N(JsonWriteUncleBlock)(N(Buffer) * b, N(UncleBlock) * u) {
+  N(Header) h = N(UncleBlockHeader)(u);
+  N(ProposalShortIdFixVec) proposals = N(UncleBlockProposals)(u);
+  return jsonLiteral(b, "{\"header\":") && N(JsonWriteHeader)(b, &h) &&
+         jsonLiteral(b, ",\"proposals\":") && jsonProposals(b, &proposals) &&
+         jsonLiteral(b, "}");
+}
+
+bool N(JsonWriteBlock)(N(Buffer) * b, N(Block) * blk) {
+  N(Header) h = N(BlockHeader)(blk);
+  if (!(jsonLiteral(b, "{\"header\":") && N(JsonWriteHeader)(b, &h) &&
+        jsonLiteral(b, ",\"uncles\":["))) {
+    return false;
+  }
+  N(UncleBlockDynVec) uncles = N(BlockUncles)(blk);
+  uint32_t len = N(UncleBlockDynVecLen)(&uncles);
+  for (uint32_t i = 0; i < len; i++) {
+    N(UncleBlock) u = N(UncleBlockDynVecGet)(&uncles, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) ||
+        (!N(JsonWriteUncleBlock)(b, &u))) {
+      return false;
+    }
+  }
+  if (!jsonLiteral(b, "],\"transactions\":[")) {
+    return false;
+  }
+  N(TransactionDynVec) txs = N(BlockTransactions)(blk);
+  len = N(TransactionDynVecLen)(&txs);
+  for (uint32_t i = 0; i < len; i++) {
+    N(Transaction) t = N(TransactionDynVecGet)(&txs, i);
+    if (((i > 0) && (!jsonLiteral(b, ","))) ||
+        (!N(JsonWriteTransaction)(b, &t))) {
+      return false;
+    }
+  }
+  N(ProposalShortIdFixVec) proposals = N(BlockProposals)(blk);
+  return jsonLiteral(b, "],\"proposals\":") && jsonProposals(b, &proposals) &&
+         jsonLiteral(b, "}");
+}
+
+/*
+ * Parsers from CKB RPC JSON into Molecule. Fields are located with a
+ * structural scan of each object and then encoded in schema order, so
+ * JSON key order does not matter; unknown keys (such as "hash") are
+ * skipped. Output is appended to the buffer; on failure its length is
+ * restored.
+ */
+
+typedef struct {
+  const uint8_t* p;
+  uint32_t pos;
+  uint32_t end;
+} N(JsonCursor);
+
+#define AMIC_JSON_MAX_FIELDS 12
+
+uint64_t jsonBroadcast(uint8_t c) { return 0x0101010101010101ULL * c; }
+
+uint64_t jsonZeroBytes(uint64_t v) {
+  return (v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL;
+}
+
+void jsonSkipWhitespace(N(JsonCursor) * c) {
+  while ((c->pos < c->end) &&
+         ((c->p[c->pos] == ' ') || (c->p[c->pos] == '\n') ||
+          (c->p[c->pos] == '\r') || (c->p[c->pos] == '\t'))) {
+    c->pos++;
+  }
+}
+
+bool jsonConsume(N(JsonCursor) * c, uint8_t ch) {
+  jsonSkipWhitespace(c);
+  if ((c->pos >= c->end) || (c->p[c->pos] != ch)) {
+    return false;
+  }
+  c->pos++;
+  return true;
+}
+
+bool jsonSkipString(N(JsonCursor) * c) {
+  c->pos++;
+  while (c->pos < c->end) {
+    if (c->pos + 8 <= c->end) {
+      uint64_t v = *((uint64_t*)&c->p[c->pos]);
+      uint64_t hit = jsonZeroBytes(v ^ jsonBroadcast('"')) |
+                     jsonZeroBytes(v ^ jsonBroadcast('\\'));
+      if (hit == 0) {
+        c->pos += 8;
+        continue;
+      }
+      c->pos += __builtin_ctzll(hit) / 8;
+    }
+    uint8_t ch = c->p[c->pos];
+    if (ch == '"') {
+      c->pos++;
+      return true;
+    }
+    c->pos += (ch == '\\') ? 2 : 1;
+  }
+  return false;
+}
+
+bool jsonSkipValue(N(JsonCursor) * c) {
+  jsonSkipWhitespace(c);
+  if (c->pos >= c->end) {
+    return false;
+  }
+  uint8_t ch = c->p[c->pos];
+  if (ch == '"') {
+    return jsonSkipString(c);
+  }
+  if ((ch == '{') || (ch == '[')) {
+    uint32_t depth = 0;
+    while (c->pos < c->end) {
+      ch = c->p[c->pos];
+      if (ch == '"') {
+        if (!jsonSkipString(c)) {
+          return false;
+        }
+        continue;
+      }
+      c->pos++;
+      if ((ch == '{') || (ch == '[')) {
+        depth++;
+      } else if ((ch == '}') || (ch == ']')) {
+        if (--depth == 0) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+  uint32_t start = c->pos;
+  while ((c->pos < c->end) && (c->p[c->pos] != ',') &&
+         (c->p[c->pos] != '}') && (c->p[c->pos] != ']') &&
+         (c->p[c->pos] != ' ') && (c->p[c->pos] != '\n') &&
+         (c->p[c->pos] != '\r') && (c->p[c->pos] != '\t')) {
+    c->pos++;
+  }
+  return c->pos > start;
+}
+
+bool jsonKeyIs(const N(JsonCursor) * key, const char* name) {
+  uint32_t i = key->pos;
+  for (; *name; name++, i++) {
+    if ((i >= key->end) || (key->p[i] != (uint8_t)*name)) {
+      return false;
+    }
+  }
+  return i == key->end;
+}
+
+/*
+ * Records the value span of every listed key; missing keys are left with
+ * p == NULL.
+ */
+bool jsonObjectFields(N(JsonCursor) * c, const char* const* names, int count,
+                      N(JsonCursor) * values) {
+  for (int i = 0; i < count; i++) {
+    values[i].p = NULL;
+  }
+  if (!jsonConsume(c, '{')) {
+    return false;
+  }
+  if (jsonConsume(c, '}')) {
+    return true;
+  }
+  do {
+    jsonSkipWhitespace(c);
+    N(JsonCursor) key = *c;
+    if ((c->pos >= c->end) || (c->p[c->pos] != '"') || (!jsonSkipString(c))) {
+      return false;
+    }
+    key.pos++;
+    key.end = c->pos - 1;
+    if (!jsonConsume(c, ':')) {
+      return false;
+    }
+    jsonSkipWhitespace(c);
+    uint32_t start = c->pos;
+    if (!jsonSkipValue(c)) {
+      return false;
+    }
+    for (int i = 0; i < count; i++) {
+      if (jsonKeyIs(&key, names[i])) {
+        if (values[i].p != NULL) {
+          return false;
+        }
+        values[i].p = c->p;
+        values[i].pos = start;
+        values[i].end = c->pos;
+        break;
+      }
+    }
+  } while (jsonConsume(c, ','));
+  return jsonConsume(c, '}');
+}
+
+bool jsonRequire(const N(JsonCursor) * values, int count) {
+  for (int i = 0; i < count; i++) {
+    if (values[i].p == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Array iteration: call with *first = true, then repeatedly; returns 1 with
+ * the next item span, 0 at the closing bracket and -1 on malformed input.
+ */
+int jsonArrayNext(N(JsonCursor) * c, N(JsonCursor) * item, bool* first) {
+  if (*first) {
+    if (!jsonConsume(c, '[')) {
+      return -1;
+    }
+  }
+  if (jsonConsume(c, ']')) {
+    return 0;
+  }
+  if ((!*first) && (!jsonConsume(c, ','))) {
+    return -1;
+  }
+  *first = false;
+  jsonSkipWhitespace(c);
+  *item = *c;
+  if (!jsonSkipValue(c)) {
+    return -1;
+  }
+  item->end = c->pos;
+  return 1;
+}
+
+int64_t jsonArrayCount(N(JsonCursor) c) {
+  N(JsonCursor) item;
+  bool first = true;
+  int64_t count = 0;
+  int r;
+  while ((r = jsonArrayNext(&c, &item, &first)) > 0) {
+    count++;
+  }
+  return (r < 0) ? -1 : count;
+}
+
+/* Returns the hex digits of a "0x..." string value. */
+bool jsonHexString(const N(JsonCursor) * v, N(JsonCursor) * digits) {
+  if ((v->end - v->pos < 4) || (v->p[v->pos] != '"') ||
+      (v->p[v->pos + 1] != '0') || (v->p[v->pos + 2] != 'x') ||
+      (v->p[v->end - 1] != '"')) {
+    return false;
+  }
+  *digits = *v;
+  digits->pos += 3;
+  digits->end -= 1;
+  return true;
+}
+
+int jsonHexValue(uint8_t ch) {
+  if ((ch >= '0') && (ch <= '9')) {
+    return ch - '0';
+  }
+  ch |= 0x20;
+  if ((ch >= 'a') && (ch <= 'f')) {
+    return ch - 'a' + 10;
+  }
+  return -1;
+}
+
+uint64_t jsonAtLeast(uint64_t v, uint8_t lo) {
+  return (v + jsonBroadcast(0x80 - lo)) & 0x8080808080808080ULL;
+}
+
+uint64_t jsonAbove(uint64_t v, uint8_t hi) {
+  return (v + jsonBroadcast(0x7F - hi)) & 0x8080808080808080ULL;
+}
+
+bool jsonHexDecode(uint8_t* dst, const uint8_t* src, uint32_t len) {
+  uint32_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint64_t v = *((uint64_t*)&src[i * 2]);
+    if (v & 0x8080808080808080ULL) {
+      return false;
+    }
+    uint64_t lower = v | jsonBroadcast(0x20);
+    uint64_t digit = jsonAtLeast(v, '0') & ~jsonAbove(v, '9');
+    uint64_t letter = jsonAtLeast(lower, 'a') & ~jsonAbove(lower, 'f');
+    if ((digit | letter) != 0x8080808080808080ULL) {
+      return false;
+    }
+    uint64_t n = (lower & jsonBroadcast(0x0F)) + (letter >> 7) * 9;
+    uint64_t x = ((n & 0x000F000F000F000FULL) << 4) |
+                 ((n >> 8) & 0x000F000F000F000FULL);
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0xFFFFFFFFULL;
+    *((uint32_t*)&dst[i]) = (uint32_t)x;
+  }
+  for (; i < len; i++) {
+    int hi = jsonHexValue(src[i * 2]);
+    int lo = jsonHexValue(src[i * 2 + 1]);
+    if ((hi < 0) || (lo < 0)) {
+      return false;
+    }
+    dst[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
+
+bool jsonParseFixedHex(const N(JsonCursor) * v, uint8_t* dst, uint32_t len) {
+  N(JsonCursor) d;
+  return jsonHexString(v, &d) && (d.end - d.pos == len * 2) &&
+         jsonHexDecode(dst, &d.p[d.pos], len);
+}
+
+bool jsonParseUintDigits(const uint8_t* s, uint32_t n, uint64_t* out) {
+  uint64_t r = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    int h = jsonHexValue(s[i]);
+    if (h < 0) {
+      return false;
+    }
+    r = (r << 4) | (uint64_t)h;
+  }
+  *out = r;
+  return true;
+}
+
+bool jsonParseUint128(const N(JsonCursor) * v, uint8_t* le) {
+  N(JsonCursor) d;
+  if (!jsonHexString(v, &d)) {
+    return false;
+  }
+  uint32_t n = d.end - d.pos;
+  if ((n == 0) || (n > 32) || ((n > 1) && (d.p[d.pos] == '0'))) {
+    return false;
+  }
+  uint32_t hiDigits = (n > 16) ? n - 16 : 0;
+  uint64_t hi = 0;
+  uint64_t lo;
+  if ((!jsonParseUintDigits(&d.p[d.pos], hiDigits, &hi)) ||
+      (!jsonParseUintDigits(&d.p[d.pos + hiDigits], n - hiDigits, &lo))) {
+    return false;
+  }
+  ((uint64_t*)le)[0] = lo;
+  ((uint64_t*)le)[1] = hi;
+  return true;
+}
+
+bool jsonParseUint(const N(JsonCursor) * v, uint64_t max, uint64_t* out) {
+  uint8_t le[16];
+  if (!jsonParseUint128(v, le)) {
+    return false;
+  }
+  *out = ((uint64_t*)le)[0];
+  return (((uint64_t*)le)[1] == 0) && (*out <= max);
+}
+
+bool jsonStringIs(const N(JsonCursor) * v, const char* s) {
+  N(JsonCursor) inner = *v;
+  if ((inner.end - inner.pos < 2) || (inner.p[inner.pos] != '"')) {
+    return false;
+  }
+  inner.pos++;
+  inner.end--;
+  return jsonKeyIs(&inner, s);
+}
+
+uint8_t* molAppend(N(Buffer) * b, uint32_t len) {
+  if (!N(BufferReserve)(b, len)) {
+    return NULL;
+  }
+  uint8_t* p = &b->p[b->length];
+  b->length += len;
+  return p;
+}
+
+bool molUint(N(Buffer) * b, const N(JsonCursor) * v, uint32_t size,
+             uint64_t max) {
+  uint64_t value;
+  uint8_t* p;
+  if ((!jsonParseUint(v, max, &value)) || ((p = molAppend(b, size)) == NULL)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < size; i++) {
+    p[i] = (uint8_t)(value >> (i * 8));
+  }
+  return true;
+}
+
+bool molFixedHex(N(Buffer) * b, const N(JsonCursor) * v, uint32_t len) {
+  uint8_t* p = molAppend(b, len);
+  return (p != NULL) && jsonParseFixedHex(v, p, len);
+}
+
+bool molBytes(N(Buffer) * b, const N(JsonCursor) * v) {
+  N(JsonCursor) d;
+  if ((!jsonHexString(v, &d)) || ((d.end - d.pos) % 2 != 0)) {
+    return false;
+  }
+  uint32_t len = (d.end - d.pos) / 2;
+  uint8_t* p = molAppend(b, 4 + len);
+  if (p == NULL) {
+    return false;
+  }
+  *((uint32_t*)p) = len;
+  return jsonHexDecode(&p[4], &d.p[d.pos], len);
+}
+
+uint32_t molHeaderBegin(N(Buffer) * b, uint32_t count) {
+  uint32_t start = b->length;
+  return (molAppend(b, 4 * (count + 1)) != NULL) ? start : UINT32_MAX;
+}
+
+void molHeaderOffset(N(Buffer) * b, uint32_t start, uint32_t index) {
+  ((uint32_t*)&b->p[start])[index + 1] = b->length - start;
+}
+
+void molHeaderEnd(N(Buffer) * b, uint32_t start) {
+  *((uint32_t*)&b->p[start]) = b->length - start;
+}
+
+typedef bool (*jsonItemParser)(N(Buffer) * b, N(JsonCursor) * item);
+
+bool molVec(N(Buffer) * b, N(JsonCursor) v, jsonItemParser parse,
+            bool dynamic) {
+  int64_t count = jsonArrayCount(v);
+  if ((count < 0) || (count > (UINT32_MAX / 4) - 1)) {
+    return false;
+  }
+  uint32_t start;
+  if (dynamic) {
+    start = molHeaderBegin(b, (uint32_t)count);
+    if (start == UINT32_MAX) {
+      return false;
+    }
+  } else {
+    uint8_t* p = molAppend(b, 4);
+    if (p == NULL) {
+      return false;
+    }
+    *((uint32_t*)p) = (uint32_t)count;
+  }
+  N(JsonCursor) item;
+  bool first = true;
+  for (uint32_t i = 0; jsonArrayNext(&v, &item, &first) > 0; i++) {
+    if (dynamic) {
+      molHeaderOffset(b, start, i);
+    }
+    if (!parse(b, &item)) {
+      return false;
+    }
+  }
+  if (dynamic) {
+    molHeaderEnd(b, start);
+  }
+  return true;
+}
+
+bool jsonHashItem(N(Buffer) * b, N(JsonCursor) * item) {
+  return molFixedHex(b, item, AMIC_HASH_SIZE);
+}
+
+bool jsonBytesItem(N(Buffer) * b, N(JsonCursor) * item) {
+  return molBytes(b, item);
+}
+
+bool jsonProposalItem(N(Buffer) * b, N(JsonCursor) * item) {
+  return molFixedHex(b, item, AMIC_PROPOSALSHORTID_SIZE);
+}
+
+bool jsonOutPoint(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"tx_hash", "index"};
+  N(JsonCursor) f[2];
+  return jsonObjectFields(v, names, 2, f) && jsonRequire(f, 2) &&
+         molFixedHex(b, &f[0], AMIC_HASH_SIZE) &&
+         molUint(b, &f[1], 4, UINT32_MAX);
+}
+
+bool jsonCellDep(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"out_point", "dep_type"};
+  N(JsonCursor) f[2];
+  if (!(jsonObjectFields(v, names, 2, f) && jsonRequire(f, 2) &&
+        jsonOutPoint(b, &f[0]))) {
+    return false;
+  }
+  uint8_t* p = molAppend(b, 1);
+  if (p == NULL) {
+    return false;
+  }
+  if (jsonStringIs(&f[1], "code")) {
+    *p = AMIC_CODE;
+  } else if (jsonStringIs(&f[1], "dep_group")) {
+    *p = AMIC_DEPGROUP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool jsonCellInput(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"since", "previous_output"};
+  N(JsonCursor) f[2];
+  return jsonObjectFields(v, names, 2, f) && jsonRequire(f, 2) &&
+         molUint(b, &f[0], 8, UINT64_MAX) && jsonOutPoint(b, &f[1]);
+}
+
+bool N(JsonParseScriptInto)(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"code_hash", "hash_type", "args"};
+  N(JsonCursor) f[3];
+  if (!(jsonObjectFields(v, names, 3, f) && jsonRequire(f, 3))) {
+    return false;
+  }
+  uint32_t start = molHeaderBegin(b, 3);
+  if (start == UINT32_MAX) {
+    return false;
+  }
+  molHeaderOffset(b, start, 0);
+  if (!molFixedHex(b, &f[0], AMIC_HASH_SIZE)) {
+    return false;
+  }
+  molHeaderOffset(b, start, 1);
+  uint8_t* p = molAppend(b, 1);
+  if (p == NULL) {
+    return false;
+  }
+  if (jsonStringIs(&f[1], "data")) {
+    *p = AMIC_DATA;
+  } else if (jsonStringIs(&f[1], "type")) {
+    *p = AMIC_TYPE;
+  } else {
+    return false;
+  }
+  molHeaderOffset(b, start, 2);
+  if (!molBytes(b, &f[2])) {
+    return false;
+  }
+  molHeaderEnd(b, start);
+  return true;
+}
+
+bool jsonCellOutput(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"capacity", "lock", "type"};
+  N(JsonCursor) f[3];
+  if (!(jsonObjectFields(v, names, 3, f) && jsonRequire(f, 2))) {
+    return false;
+  }
+  uint32_t start = molHeaderBegin(b, 3);
+  if (start == UINT32_MAX) {
+    return false;
+  }
+  molHeaderOffset(b, start, 0);
+  if (!molUint(b, &f[0], 8, UINT64_MAX)) {
+    return false;
+  }
+  molHeaderOffset(b, start, 1);
+  if (!N(JsonParseScriptInto)(b, &f[1])) {
+    return false;
+  }
+  molHeaderOffset(b, start, 2);
+  if ((f[2].p != NULL) && (!jsonKeyIs(&f[2], "null"))) {
+    if (!N(JsonParseScriptInto)(b, &f[2])) {
+      return false;
+    }
+  }
+  molHeaderEnd(b, start);
+  return true;
+}
+
+bool N(JsonParseTransactionInto)(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"version",      "cell_deps",
+                                      "header_deps",  "inputs",
+                                      "outputs",      "outputs_data",
+                                      "witnesses"};
+  N(JsonCursor) f[7];
+  if (!(jsonObjectFields(v, names, 7, f) && jsonRequire(f, 7))) {
+    return false;
+  }
+  uint32_t start = molHeaderBegin(b, 2);
+  if (start == UINT32_MAX) {
+    return false;
+  }
+  molHeaderOffset(b, start, 0);
+  uint32_t raw = molHeaderBegin(b, 6);
+  if (raw == UINT32_MAX) {
+    return false;
+  }
+  molHeaderOffset(b, raw, 0);
+  if (!molUint(b, &f[0], 4, UINT32_MAX)) {
+    return false;
+  }
+  molHeaderOffset(b, raw, 1);
+  if (!molVec(b, f[1], jsonCellDep, false)) {
+    return false;
+  }
+  molHeaderOffset(b, raw, 2);
+  if (!molVec(b, f[2], jsonHashItem, false)) {
+    return false;
+  }
+  molHeaderOffset(b, raw, 3);
+  if (!molVec(b, f[3], jsonCellInput, false)) {
+    return false;
+  }
+  molHeaderOffset(b, raw, 4);
+  if (!molVec(b, f[4], jsonCellOutput, true)) {
+    return false;
+  }
+  molHeaderOffset(b, raw, 5);
+  if (!molVec(b, f[5], jsonBytesItem, true)) {
+    return false;
+  }
+  molHeaderEnd(b, raw);
+  molHeaderOffset(b, start, 1);
+  if (!molVec(b, f[6], jsonBytesItem, true)) {
+    return false;
+  }
+  molHeaderEnd(b, start);
+  return true;
+}
+
+bool N(JsonParseHeaderInto)(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {
+      "version",        "compact_target",    "timestamp", "number",
+      "epoch",          "parent_hash",       "transactions_root",
+      "proposals_hash", "uncles_hash",       "dao",       "nonce"};
+  N(JsonCursor) f[11];
+  if (!(jsonObjectFields(v, names, 11, f) && jsonRequire(f, 11))) {
+    return false;
+  }
+  uint64_t version, compactTarget, timestamp, number, epoch;
+  if (!(jsonParseUint(&f[0], UINT32_MAX, &version) &&
+        jsonParseUint(&f[1], UINT32_MAX, &compactTarget) &&
+        jsonParseUint(&f[2], UINT64_MAX, &timestamp) &&
+        jsonParseUint(&f[3], UINT64_MAX, &number) &&
+        jsonParseUint(&f[4], UINT64_MAX, &epoch))) {
+    return false;
+  }
+  uint8_t* p = molAppend(b, AMIC_HEADER_SIZE);
+  if (p == NULL) {
+    return false;
+  }
+  ((uint32_t*)p)[0] = (uint32_t)version;
+  ((uint32_t*)p)[1] = (uint32_t)compactTarget;
+  ((uint64_t*)p)[1] = timestamp;
+  ((uint64_t*)p)[2] = number;
+  ((uint64_t*)p)[3] = epoch;
+  for (int i = 0; i < 5; i++) {
+    if (!jsonParseFixedHex(&f[5 + i], &p[32 + i * 32], 32)) {
+      return false;
+    }
+  }
+  return jsonParseUint128(&f[10], &p[AMIC_RAWHEADER_SIZE]);
+}
+
+bool jsonUncleBlock(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"header", "proposals"};
+  N(JsonCursor) f[2];
+  if (!(jsonObjectFields(v, names, 2, f) && jsonRequire(f, 2))) {
+    return false;
+  }
+  uint32_t start = molHeaderBegin(b, 2);
+  if (start == UINT32_MAX) {
+    return false;
+  }
+  molHeaderOffset(b, start, 0);
+  if (!N(JsonParseHeaderInto)(b, &f[0])) {
+    return false;
+  }
+  molHeaderOffset(b, start, 1);
+  if (!molVec(b, f[1], jsonProposalItem, false)) {
+    return false;
+  }
+  molHeaderEnd(b, start);
+  return true;
+}
+
+bool N(JsonParseBlockInto)(N(Buffer) * b, N(JsonCursor) * v) {
+  static const char* const names[] = {"header", "uncles", "transactions",
+                                      "proposals"};
+  N(JsonCursor) f[4];
+  if (!(jsonObjectFields(v, names, 4, f) && jsonRequire(f, 4))) {
+    return false;
+  }
+  uint32_t start = molHeaderBegin(b, 4);
+  if (start == UINT32_MAX) {
+    return false;
+  }
+  molHeaderOffset(b, start, 0);
+  if (!N(JsonParseHeaderInto)(b, &f[0])) {
+    return false;
+  }
+  molHeaderOffset(b, start, 1);
+  if (!molVec(b, f[1], jsonUncleBlock, true)) {
+    return false;
+  }
+  molHeaderOffset(b, start, 2);
+  if (!molVec(b, f[2], N(JsonParseTransactionInto), true)) {
+    return false;
+  }
+  molHeaderOffset(b, start, 3);
+  if (!molVec(b, f[3], jsonProposalItem, false)) {
+    return false;
+  }
+  molHeaderEnd(b, start);
+  return true;
+}
+
+bool jsonParseDocument(const void* json, uint32_t len, N(Buffer) * b,
+                       jsonItemParser parse, N(Slice) * out) {
+  N(JsonCursor) c;
+  c.p = (const uint8_t*)json;
+  c.pos = 0;
+  c.end = len;
+  uint32_t start = b->length;
+  bool ok = parse(b, &c);
+  jsonSkipWhitespace(&c);
+  if ((!ok) || (c.pos != c.end)) {
+    b->length = start;
+    return false;
+  }
+  out->p = &b->p[start];
+  out->length = b->length - start;
+  return true;
+}
+
+bool N(JsonParseTransaction)(const void* json, uint32_t len, N(Buffer) * b,
+                             N(Transaction) * out) {
+  return jsonParseDocument(json, len, b, N(JsonParseTransactionInto),
+                           &out->s);
+}
+
+bool N(JsonParseBlock)(const void* json, uint32_t len, N(Buffer) * b,
+                       N(Block) * out) {
+  return jsonParseDocument(json, len, b, N(JsonParseBlockInto), &out->s);
+}
+
+#undef N
+
+#endif /* AMIC_JSON_H_ */
@@ -0,0 +1,357 @@
+#ifndef AMIC_MEMPOOL_H_
+#define AMIC_MEMPOOL_H_
+
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+/* Four buckets per power of two of the fee rate. */
+#define AMIC_MEMPOOL_BUCKETS 256
+
+/*
+ * Everything mempool admission reads from a verified transaction. size is
+ * the serialized size plus the 4 byte offset the transaction takes in a
+ * block, the size CKB charges fees against. inputs stays a view into the
+ * transaction, for resolving the previous outputs against live cells.
+ */
+typedef struct {
+  uint32_t size;
+  uint32_t cellDepCount;
+  uint32_t headerDepCount;
+  uint32_t inputCount;
+  uint32_t outputCount;
+  uint64_t outputCapacity;
+  N(CellInputFixVec) inputs;
+} N(TxSummary);
+
+uint32_t mempoolWord(const uint8_t* p) { return *((uint32_t*)p); }
+
+/*
+ * Fills s in a single walk over the offsets of tx, reading each output
+ * capacity straight from the output table. Vector counts come from the
+ * field bounds in the raw transaction's offsets, never from the count
+ * words. tx must have passed TransactionVerify. Returns false if the output
+ * capacities overflow.
+ */
+bool N(TxSummaryExtract)(N(Transaction) * tx, N(TxSummary) * s) {
+  const uint8_t* t = tx->s.p;
+  const uint8_t* raw = &t[mempoolWord(&t[4])];
+  uint32_t cellDeps = mempoolWord(&raw[8]);
+  uint32_t headerDeps = mempoolWord(&raw[12]);
+  uint32_t inputs = mempoolWord(&raw[16]);
+  uint32_t outputsStart = mempoolWord(&raw[20]);
+  s->size = tx->s.length + 4;
+  s->cellDepCount = (headerDeps - cellDeps - 4) / AMIC_CELLDEP_SIZE;
+  s->headerDepCount = (inputs - headerDeps - 4) / AMIC_HASH_SIZE;
+  s->inputs.s.p = (uint8_t*)&raw[inputs];
+  s->inputs.s.length = outputsStart - inputs;
+  s->inputCount = (s->inputs.s.length - 4) / AMIC_CELLINPUT_SIZE;
+  const uint8_t* outputs = &raw[outputsStart];
+  s->outputCount = 0;
+  s->outputCapacity = 0;
+  if (mempoolWord(outputs) > 4) {
+    s->outputCount = mempoolWord(&outputs[4]) / 4 - 1;
+  }
+  bool ok = true;
+  for (uint32_t i = 0; i < s->outputCount; i++) {
+    const uint8_t* output = &outputs[mempoolWord(&outputs[4 + 4 * i])];
+    uint64_t capacity = *((uint64_t*)&output[mempoolWord(&output[4])]);
+    ok = (s->outputCapacity + capacity >= capacity) && ok;
+    s->outputCapacity += capacity;
+  }
+  return ok;
+}
+
+/* Returns false when the inputs do not cover the outputs. */
+bool N(TxSummaryFee)(N(TxSummary) * s, uint64_t inputCapacity,
+                     uint64_t* fee) {
+  if (inputCapacity < s->outputCapacity) {
+    return false;
+  }
+  *fee = inputCapacity - s->outputCapacity;
+  return true;
+}
+
+/* Bucket sets of the index, one pair of links per set in each entry. */
+#define AMIC_MEMPOOL_BY_ANCESTOR 0
+#define AMIC_MEMPOOL_BY_DESCENDANT 1
+
+/*
+ * An index entry, embedded by the caller in its own transaction record.
+ * ancestorFee and ancestorSize cover the transaction plus all of its
+ * unconfirmed ancestors, descendantFee and descendantSize the transaction
+ * plus all of its unconfirmed descendants. Mining takes the best ancestor
+ * package, so a cheap child of a generous parent is not mined alone;
+ * eviction takes the worst descendant package, so a parent is never
+ * evicted while a child it pays for stays behind unchecked.
+ */
+typedef struct N(MempoolEntry) {
+  struct N(MempoolEntry) * prev[2];
+  struct N(MempoolEntry) * next[2];
+  uint32_t bucket[2];
+  uint64_t fee;
+  uint64_t size;
+  uint64_t ancestorFee;
+  uint64_t ancestorSize;
+  uint64_t descendantFee;
+  uint64_t descendantSize;
+} N(MempoolEntry);
+
+/*
+ * Prepares e for insertion as a transaction with no unconfirmed ancestors
+ * or descendants; add each ancestor afterwards. Every ancestor must be
+ * added exactly once, including the shared ones of a diamond.
+ */
+void N(MempoolEntryInit)(N(MempoolEntry) * e, uint64_t fee, uint32_t size) {
+  memset(e, 0, sizeof(N(MempoolEntry)));
+  e->fee = fee;
+  e->size = size;
+  e->ancestorFee = fee;
+  e->ancestorSize = size;
+  e->descendantFee = fee;
+  e->descendantSize = size;
+}
+
+void N(MempoolEntryAddAncestor)(N(MempoolEntry) * e,
+                                N(MempoolEntry) * ancestor) {
+  e->ancestorFee += ancestor->fee;
+  e->ancestorSize += ancestor->size;
+}
+
+/*
+ * Entries bucketed by the log of a package fee rate in shannons per KB,
+ * each bucket a FIFO list, with a bitmap of the nonempty buckets. Every
+ * entry sits in two bucket sets, one ranked by its ancestor package and
+ * one by its descendant package. Insert, remove, best and worst are all
+ * constant time: bucket lookup is a leading zero count and finding the
+ * extreme bucket scans four words. Operations take a spinlock, they never
+ * hold it for more than a handful of pointer updates.
+ */
+typedef struct {
+  N(MempoolEntry) * heads[2][AMIC_MEMPOOL_BUCKETS];
+  N(MempoolEntry) * tails[2][AMIC_MEMPOOL_BUCKETS];
+  uint64_t occupied[2][AMIC_MEMPOOL_BUCKETS / 64];
+  uint64_t count;
+  uint64_t totalSize;
+  uint8_t lock;
+} N(MempoolIndex);
+
+void N(MempoolIndexInit)(N(MempoolIndex) * m) {
+  memset(m, 0, sizeof(N(MempoolIndex)));
+}
+
+void mempoolLock(N(MempoolIndex) * m) {
+  while (__atomic_test_and_set(&m->lock, __ATOMIC_ACQUIRE)) {
+    while (__atomic_load_n(&m->lock, __ATOMIC_RELAXED)) {
+    }
+  }
+}
+
+void mempoolUnlock(N(MempoolIndex) * m) {
+  __atomic_clear(&m->lock, __ATOMIC_RELEASE);
+}
+
+/*
+ * Fee rate in shannons per KB. Saturates for absurd fees and empty
+ * packages, which land in the top bucket.
+ */
+uint64_t mempoolRate(uint64_t fee, uint64_t size) {
+  if ((size == 0) || (fee / size >= UINT64_MAX / 1000)) {
+    return UINT64_MAX;
+  }
+  return fee / size * 1000 + fee % size * 1000 / size;
+}
+
+uint32_t mempoolBucket(uint64_t fee, uint64_t size) {
+  uint64_t rate = mempoolRate(fee, size);
+  if (rate < 4) {
+    return (uint32_t)rate;
+  }
+  uint32_t exponent = 63 - __builtin_clzll(rate);
+  return exponent * 4 + (uint32_t)((rate >> (exponent - 2)) & 3);
+}
+
+/*
+ * A descendant package ranks no lower than the transaction itself, so a
+ * generous parent is not evicted for the sake of its cheap children; those
+ * rank lower on their own and go first.
+ */
+uint32_t mempoolEntryBucket(N(MempoolEntry) * e, int set) {
+  uint32_t b = mempoolBucket(e->ancestorFee, e->ancestorSize);
+  if (set == AMIC_MEMPOOL_BY_DESCENDANT) {
+    uint32_t own = mempoolBucket(e->fee, e->size);
+    b = mempoolBucket(e->descendantFee, e->descendantSize);
+    b = (own > b) ? own : b;
+  }
+  return b;
+}
+
+void mempoolLink(N(MempoolIndex) * m, N(MempoolEntry) * e, int set) {
+  uint32_t b = mempoolEntryBucket(e, set);
+  e->bucket[set] = b;
+  e->next[set] = NULL;
+  e->prev[set] = m->tails[set][b];
+  if (e->prev[set] != NULL) {
+    e->prev[set]->next[set] = e;
+  } else {
+    m->heads[set][b] = e;
+    m->occupied[set][b / 64] |= 1ULL << (b % 64);
+  }
+  m->tails[set][b] = e;
+}
+
+void mempoolUnlink(N(MempoolIndex) * m, N(MempoolEntry) * e, int set) {
+  uint32_t b = e->bucket[set];
+  if (e->prev[set] != NULL) {
+    e->prev[set]->next[set] = e->next[set];
+  } else {
+    m->heads[set][b] = e->next[set];
+  }
+  if (e->next[set] != NULL) {
+    e->next[set]->prev[set] = e->prev[set];
+  } else {
+    m->tails[set][b] = e->prev[set];
+  }
+  if (m->heads[set][b] == NULL) {
+    m->occupied[set][b / 64] &= ~(1ULL << (b % 64));
+  }
+  e->prev[set] = e->next[set] = NULL;
+}
+
+void mempoolAdd(N(MempoolIndex) * m, N(MempoolEntry) * e) {
+  mempoolLink(m, e, AMIC_MEMPOOL_BY_ANCESTOR);
+  mempoolLink(m, e, AMIC_MEMPOOL_BY_DESCENDANT);
+  m->count++;
+  m->totalSize += e->size;
+}
+
+void mempoolDelete(N(MempoolIndex) * m, N(MempoolEntry) * e) {
+  mempoolUnlink(m, e, AMIC_MEMPOOL_BY_ANCESTOR);
+  mempoolUnlink(m, e, AMIC_MEMPOOL_BY_DESCENDANT);
+  m->count--;
+  m->totalSize -= e->size;
+}
+
+/* Oldest entry of the highest bucket of set, or NULL. */
+N(MempoolEntry) * mempoolBest(N(MempoolIndex) * m, int set) {
+  for (int i = AMIC_MEMPOOL_BUCKETS / 64 - 1; i >= 0; i--) {
+    if (m->occupied[set][i] != 0) {
+      return m->heads[set][i * 64 + 63 - __builtin_clzll(m->occupied[set][i])];
+    }
+  }
+  return NULL;
+}
+
+/* Newest entry of the lowest bucket of set, or NULL. */
+N(MempoolEntry) * mempoolWorst(N(MempoolIndex) * m, int set) {
+  for (int i = 0; i < AMIC_MEMPOOL_BUCKETS / 64; i++) {
+    if (m->occupied[set][i] != 0) {
+      return m->tails[set][i * 64 + __builtin_ctzll(m->occupied[set][i])];
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Inserting a child changes the descendant package of each of its
+ * ancestors; follow up with MempoolIndexAddDescendant for every one.
+ */
+void N(MempoolIndexInsert)(N(MempoolIndex) * m, N(MempoolEntry) * e) {
+  mempoolLock(m);
+  mempoolAdd(m, e);
+  mempoolUnlock(m);
+}
+
+void N(MempoolIndexRemove)(N(MempoolIndex) * m, N(MempoolEntry) * e) {
+  mempoolLock(m);
+  mempoolDelete(m, e);
+  mempoolUnlock(m);
+}
+
+/*
+ * Moves e to the buckets of its new package totals, after an ancestor or
+ * descendant was mined, evicted or replaced.
+ */
+void N(MempoolIndexUpdate)(N(MempoolIndex) * m, N(MempoolEntry) * e,
+                           uint64_t ancestorFee, uint64_t ancestorSize,
+                           uint64_t descendantFee, uint64_t descendantSize) {
+  mempoolLock(m);
+  mempoolUnlink(m, e, AMIC_MEMPOOL_BY_ANCESTOR);
+  mempoolUnlink(m, e, AMIC_MEMPOOL_BY_DESCENDANT);
+  e->ancestorFee = ancestorFee;
+  e->ancestorSize = ancestorSize;
+  e->descendantFee = descendantFee;
+  e->descendantSize = descendantSize;
+  mempoolLink(m, e, AMIC_MEMPOOL_BY_ANCESTOR);
+  mempoolLink(m, e, AMIC_MEMPOOL_BY_DESCENDANT);
+  mempoolUnlock(m);
+}
+
+/* Adds a newly inserted descendant to the descendant package of e. */
+void N(MempoolIndexAddDescendant)(N(MempoolIndex) * m, N(MempoolEntry) * e,
+                                  N(MempoolEntry) * descendant) {
+  mempoolLock(m);
+  mempoolUnlink(m, e, AMIC_MEMPOOL_BY_DESCENDANT);
+  e->descendantFee += descendant->fee;
+  e->descendantSize += descendant->size;
+  mempoolLink(m, e, AMIC_MEMPOOL_BY_DESCENDANT);
+  mempoolUnlock(m);
+}
+
+/*
+ * Removes and returns the entry with the best ancestor package fee rate,
+ * or NULL when the index is empty. Bucket granularity is a quarter power
+ * of two, ties within a bucket go to the oldest entry.
+ */
+N(MempoolEntry) * N(MempoolIndexPopBest)(N(MempoolIndex) * m) {
+  mempoolLock(m);
+  N(MempoolEntry)* e = mempoolBest(m, AMIC_MEMPOOL_BY_ANCESTOR);
+  if (e != NULL) {
+    mempoolDelete(m, e);
+  }
+  mempoolUnlock(m);
+  return e;
+}
+
+/*
+ * While the total size exceeds maxSize, removes and returns the entry with
+ * the worst descendant package fee rate; returns NULL once it fits. Only
+ * that entry leaves the index: the caller must remove its descendants,
+ * which cannot stay without it, and update the descendant totals of its
+ * ancestors before calling again, so the next pick sees the smaller pool.
+ */
+N(MempoolEntry) * N(MempoolIndexEvict)(N(MempoolIndex) * m, uint64_t maxSize) {
+  N(MempoolEntry)* e = NULL;
+  mempoolLock(m);
+  if (m->totalSize > maxSize) {
+    e = mempoolWorst(m, AMIC_MEMPOOL_BY_DESCENDANT);
+    mempoolDelete(m, e);
+  }
+  mempoolUnlock(m);
+  return e;
+}
+
+/*
+ * Ancestor package fee rate of the worst entry, the floor for new
+ * admissions.
+ */
+uint64_t N(MempoolIndexMinFeeRate)(N(MempoolIndex) * m) {
+  mempoolLock(m);
+  N(MempoolEntry)* e = mempoolWorst(m, AMIC_MEMPOOL_BY_ANCESTOR);
+  uint64_t rate = 0;
+  if ((e != NULL) && (e->ancestorSize != 0)) {
+    rate = mempoolRate(e->ancestorFee, e->ancestorSize);
+  }
+  mempoolUnlock(m);
+  return rate;
+}
+
+#undef N
+
+#endif /* AMIC_MEMPOOL_H_ */
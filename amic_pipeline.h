@@ -0,0 +1,480 @@
+#ifndef AMIC_PIPELINE_H_
+#define AMIC_PIPELINE_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+#define AMIC_STAGE_READ 0
+#define AMIC_STAGE_PRECHECK 1
+#define AMIC_STAGE_VERIFY 2
+#define AMIC_STAGE_HASH 3
+#define AMIC_STAGE_COMMIT 4
+#define AMIC_STAGE_COUNT 5
+
+#define AMIC_PIPELINE_MAX_THREADS 64
+
+/* Bounded multi-producer multi-consumer ring (Vyukov). */
+typedef struct {
+  uint64_t seq;
+  void* data;
+} pipelineCell;
+
+typedef struct {
+  pipelineCell* cells;
+  uint64_t mask;
+  uint64_t head __attribute__((aligned(64)));
+  uint64_t tail __attribute__((aligned(64)));
+} N(PipelineQueue);
+
+bool N(PipelineQueueInit)(N(PipelineQueue) * q, uint32_t capacity) {
+  uint64_t size = 2;
+  while (size < capacity) {
+    size *= 2;
+  }
+  q->cells = (pipelineCell*)malloc(size * sizeof(pipelineCell));
+  if (q->cells == NULL) {
+    return false;
+  }
+  for (uint64_t i = 0; i < size; i++) {
+    q->cells[i].seq = i;
+  }
+  q->mask = size - 1;
+  q->head = 0;
+  q->tail = 0;
+  return true;
+}
+
+bool N(PipelineQueuePush)(N(PipelineQueue) * q, void* data) {
+  uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  pipelineCell* cell;
+  while (true) {
+    cell = &q->cells[pos & q->mask];
+    int64_t dif =
+        (int64_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (int64_t)pos;
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      return false;
+    } else {
+      pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    }
+  }
+  cell->data = data;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool N(PipelineQueuePop)(N(PipelineQueue) * q, void** data) {
+  uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+  pipelineCell* cell;
+  while (true) {
+    cell = &q->cells[pos & q->mask];
+    int64_t dif = (int64_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) -
+                  (int64_t)(pos + 1);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      return false;
+    } else {
+      pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    }
+  }
+  *data = cell->data;
+  __atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+/*
+ * One block travelling through the pipeline. block is filled by the read
+ * callback; ok turns false at the first failing stage and later stages
+ * pass the item through untouched so the commit stage still sees it in
+ * order. txHashes holds one hash per transaction after the hash stage.
+ */
+typedef struct {
+  uint64_t seq;
+  N(Block) block;
+  bool ok;
+  int failedStage;
+  uint8_t headerHash[AMIC_HASH_SIZE];
+  uint8_t* txHashes;
+  uint32_t txCount;
+} N(SyncItem);
+
+/*
+ * read fetches block number seq (from disk, io_uring completions, the
+ * network...) and returns false at the end of the range. release is
+ * called once the item has been committed or dropped. hashers must hold
+ * one independent hasher per hash-stage thread. commit runs on a single
+ * thread in strictly increasing seq order; returning false stops the run.
+ */
+typedef struct {
+  uint32_t threads[AMIC_STAGE_COUNT];
+  uint32_t queueCapacity;
+  uint64_t first;
+  bool compatible;
+  bool (*read)(void* ctx, uint64_t seq, N(Slice) * block);
+  void (*release)(void* ctx, N(SyncItem) * item);
+  N(Hasher) * hashers;
+  bool (*commit)(void* ctx, N(SyncItem) * item);
+  void* ctx;
+} N(PipelineConfig);
+
+typedef struct {
+  uint64_t items;
+  uint64_t bytes;
+  uint64_t fullStalls;
+  uint64_t emptyStalls;
+} N(StageStats);
+
+typedef struct {
+  N(StageStats) stages[AMIC_STAGE_COUNT];
+  uint64_t committed;
+  uint64_t inFlight;
+} N(PipelineStats);
+
+typedef struct N(Pipeline) N(Pipeline);
+
+typedef struct {
+  N(Pipeline) * p;
+  int stage;
+  uint32_t index;
+} pipelineWorker;
+
+struct N(Pipeline) {
+  N(PipelineConfig) cfg;
+  N(PipelineQueue) queues[AMIC_STAGE_COMMIT];
+  N(SyncItem) * items;
+  uint8_t* live;
+  uint64_t window;
+  uint64_t nextRead;
+  uint64_t end;
+  uint64_t committed;
+  bool stop;
+  bool failed;
+  N(PipelineStats) stats;
+  pthread_t threads[AMIC_STAGE_COUNT][AMIC_PIPELINE_MAX_THREADS];
+  pipelineWorker workers[AMIC_STAGE_COUNT][AMIC_PIPELINE_MAX_THREADS];
+};
+
+void pipelineCount(uint64_t* counter, uint64_t value) {
+  __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+bool pipelineStopped(N(Pipeline) * p) {
+  return __atomic_load_n(&p->stop, __ATOMIC_ACQUIRE);
+}
+
+bool pipelinePush(N(Pipeline) * p, int stage, N(SyncItem) * item) {
+  uint32_t length = item->block.s.length;
+  while (!N(PipelineQueuePush)(&p->queues[stage], item)) {
+    pipelineCount(&p->stats.stages[stage].fullStalls, 1);
+    if (pipelineStopped(p)) {
+      return false;
+    }
+    sched_yield();
+  }
+  pipelineCount(&p->stats.stages[stage].items, 1);
+  pipelineCount(&p->stats.stages[stage].bytes, length);
+  return true;
+}
+
+N(SyncItem) * pipelinePop(N(Pipeline) * p, int stage) {
+  void* item;
+  while (!N(PipelineQueuePop)(&p->queues[stage - 1], &item)) {
+    pipelineCount(&p->stats.stages[stage].emptyStalls, 1);
+    if (pipelineStopped(p)) {
+      return NULL;
+    }
+    sched_yield();
+  }
+  return (N(SyncItem)*)item;
+}
+
+void pipelineFail(N(SyncItem) * item, int stage) {
+  if (item->ok) {
+    item->ok = false;
+    item->failedStage = stage;
+  }
+}
+
+void pipelinePrecheck(N(Pipeline) * p, N(SyncItem) * item) {
+  int offset_count =
+      verifyAndExtractOffsetCount(&item->block.s, 4, p->cfg.compatible);
+  if ((offset_count < 0) ||
+      (extractOffset(&item->block.s, 1, offset_count) -
+           extractOffset(&item->block.s, 0, offset_count) !=
+       AMIC_HEADER_SIZE)) {
+    pipelineFail(item, AMIC_STAGE_PRECHECK);
+  }
+}
+
+void pipelineHash(N(Hasher) * h, N(SyncItem) * item) {
+  N(Header) header = N(BlockHeader)(&item->block);
+  N(HasherHash)(h, header.s.p, header.s.length, item->headerHash);
+  N(TransactionDynVec) txs = N(BlockTransactions)(&item->block);
+  item->txCount = N(TransactionDynVecLen)(&txs);
+  item->txHashes = (uint8_t*)malloc((size_t)item->txCount * AMIC_HASH_SIZE);
+  if ((item->txHashes == NULL) && (item->txCount > 0)) {
+    pipelineFail(item, AMIC_STAGE_HASH);
+    return;
+  }
+  for (uint32_t i = 0; i < item->txCount; i++) {
+    N(Transaction) tx = N(TransactionDynVecGet)(&txs, i);
+    N(RawTransaction) raw = N(TransactionRaw)(&tx);
+    N(HasherHash)(h, raw.s.p, raw.s.length,
+                  &item->txHashes[i * AMIC_HASH_SIZE]);
+  }
+}
+
+void* pipelineReader(void* arg) {
+  pipelineWorker* w = (pipelineWorker*)arg;
+  N(Pipeline)* p = w->p;
+  while (!pipelineStopped(p)) {
+    uint64_t seq = __atomic_fetch_add(&p->nextRead, 1, __ATOMIC_RELAXED);
+    if (seq >= __atomic_load_n(&p->end, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    while ((seq >= __atomic_load_n(&p->committed, __ATOMIC_ACQUIRE) +
+                       p->window) &&
+           (!pipelineStopped(p))) {
+      pipelineCount(&p->stats.stages[AMIC_STAGE_READ].fullStalls, 1);
+      sched_yield();
+    }
+    N(SyncItem)* item = &p->items[seq % p->window];
+    memset(item, 0, sizeof(N(SyncItem)));
+    item->seq = seq;
+    item->ok = true;
+    if (!p->cfg.read(p->cfg.ctx, seq, &item->block.s)) {
+      uint64_t end = __atomic_load_n(&p->end, __ATOMIC_RELAXED);
+      while ((seq < end) &&
+             (!__atomic_compare_exchange_n(&p->end, &end, seq, true,
+                                           __ATOMIC_RELEASE,
+                                           __ATOMIC_RELAXED))) {
+      }
+      break;
+    }
+    p->live[seq % p->window] = 1;
+    if (!pipelinePush(p, AMIC_STAGE_READ, item)) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+void* pipelineStage(void* arg) {
+  pipelineWorker* w = (pipelineWorker*)arg;
+  N(Pipeline)* p = w->p;
+  N(SyncItem)* item;
+  while ((item = pipelinePop(p, w->stage)) != NULL) {
+    if (item->ok) {
+      if (w->stage == AMIC_STAGE_PRECHECK) {
+        pipelinePrecheck(p, item);
+      } else if (w->stage == AMIC_STAGE_VERIFY) {
+        if (!N(BlockVerify)(&item->block, p->cfg.compatible)) {
+          pipelineFail(item, AMIC_STAGE_VERIFY);
+        }
+      } else {
+        pipelineHash(&p->cfg.hashers[w->index], item);
+      }
+    }
+    if (!pipelinePush(p, w->stage, item)) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+void pipelineRelease(N(Pipeline) * p, N(SyncItem) * item) {
+  if (p->cfg.release) {
+    p->cfg.release(p->cfg.ctx, item);
+  }
+  free(item->txHashes);
+  item->txHashes = NULL;
+  p->live[item->seq % p->window] = 0;
+}
+
+/* Restores seq order: items land in their window slot until their turn. */
+void* pipelineCommitter(void* arg) {
+  pipelineWorker* w = (pipelineWorker*)arg;
+  N(Pipeline)* p = w->p;
+  uint64_t next = p->cfg.first;
+  uint8_t* ready = (uint8_t*)calloc(p->window, 1);
+  if (ready == NULL) {
+    p->failed = true;
+    __atomic_store_n(&p->stop, true, __ATOMIC_RELEASE);
+    return NULL;
+  }
+  while (next < __atomic_load_n(&p->end, __ATOMIC_ACQUIRE)) {
+    if (ready[next % p->window]) {
+      N(SyncItem)* item = &p->items[next % p->window];
+      ready[next % p->window] = 0;
+      bool ok = p->cfg.commit(p->cfg.ctx, item);
+      pipelineCount(&p->stats.stages[AMIC_STAGE_COMMIT].items, 1);
+      pipelineCount(&p->stats.stages[AMIC_STAGE_COMMIT].bytes,
+                    item->block.s.length);
+      pipelineRelease(p, item);
+      next++;
+      __atomic_store_n(&p->committed, next, __ATOMIC_RELEASE);
+      if (!ok) {
+        p->failed = true;
+        break;
+      }
+      continue;
+    }
+    void* data;
+    if (N(PipelineQueuePop)(&p->queues[AMIC_STAGE_HASH], &data)) {
+      N(SyncItem)* item = (N(SyncItem)*)data;
+      if (item->seq >= __atomic_load_n(&p->end, __ATOMIC_ACQUIRE)) {
+        pipelineRelease(p, item);
+      } else {
+        ready[item->seq % p->window] = 1;
+      }
+    } else {
+      pipelineCount(&p->stats.stages[AMIC_STAGE_COMMIT].emptyStalls, 1);
+      sched_yield();
+    }
+  }
+  __atomic_store_n(&p->stop, true, __ATOMIC_RELEASE);
+  free(ready);
+  return NULL;
+}
+
+/*
+ * Joins the threads that were started, releases blocks that were read but
+ * never committed and frees what PipelineStart allocated. Leaves nothing
+ * to join or free, so a second call is harmless.
+ */
+void pipelineShutdown(N(Pipeline) * p) {
+  for (int s = 0; s < AMIC_STAGE_COUNT; s++) {
+    for (uint32_t i = 0; i < p->cfg.threads[s]; i++) {
+      pthread_join(p->threads[s][i], NULL);
+    }
+    p->cfg.threads[s] = 0;
+  }
+  if ((p->items != NULL) && (p->live != NULL)) {
+    for (uint64_t i = 0; i < p->window; i++) {
+      if (p->live[i]) {
+        pipelineRelease(p, &p->items[i]);
+      }
+    }
+  }
+  for (int s = 0; s < AMIC_STAGE_COMMIT; s++) {
+    free(p->queues[s].cells);
+    p->queues[s].cells = NULL;
+  }
+  free(p->items);
+  free(p->live);
+  p->items = NULL;
+  p->live = NULL;
+}
+
+/*
+ * Undoes a failed start: stops the threads created before stage/started,
+ * joins them and frees everything. Always returns false.
+ */
+bool pipelineAbort(N(Pipeline) * p, int stage, uint32_t started) {
+  __atomic_store_n(&p->stop, true, __ATOMIC_RELEASE);
+  p->cfg.threads[stage] = started;
+  for (int s = stage + 1; s < AMIC_STAGE_COUNT; s++) {
+    p->cfg.threads[s] = 0;
+  }
+  pipelineShutdown(p);
+  return false;
+}
+
+/*
+ * Starts reader, pre-check, verify, hash and commit threads. The commit
+ * stage always runs on one thread; every other stage uses the configured
+ * number of threads (at least one). The reorder window, and thus the
+ * number of blocks in flight, is bounded by the queue capacities.
+ */
+bool N(PipelineStart)(N(Pipeline) * p, N(PipelineConfig) * cfg) {
+  memset(p, 0, sizeof(N(Pipeline)));
+  p->cfg = *cfg;
+  p->cfg.threads[AMIC_STAGE_COMMIT] = 1;
+  uint64_t threads = 0;
+  for (int s = 0; s < AMIC_STAGE_COUNT; s++) {
+    if (p->cfg.threads[s] == 0) {
+      p->cfg.threads[s] = 1;
+    }
+    if (p->cfg.threads[s] > AMIC_PIPELINE_MAX_THREADS) {
+      return false;
+    }
+    threads += p->cfg.threads[s];
+  }
+  for (int s = 0; s < AMIC_STAGE_COMMIT; s++) {
+    if (!N(PipelineQueueInit)(&p->queues[s], cfg->queueCapacity)) {
+      return pipelineAbort(p, AMIC_STAGE_READ, 0);
+    }
+  }
+  p->window = (p->queues[0].mask + 1) * AMIC_STAGE_COMMIT + threads;
+  p->items = (N(SyncItem)*)calloc(p->window, sizeof(N(SyncItem)));
+  p->live = (uint8_t*)calloc(p->window, 1);
+  if ((p->items == NULL) || (p->live == NULL)) {
+    return pipelineAbort(p, AMIC_STAGE_READ, 0);
+  }
+  p->nextRead = cfg->first;
+  p->end = UINT64_MAX;
+  p->committed = cfg->first;
+  for (int s = 0; s < AMIC_STAGE_COUNT; s++) {
+    for (uint32_t i = 0; i < p->cfg.threads[s]; i++) {
+      pipelineWorker* w = &p->workers[s][i];
+      w->p = p;
+      w->stage = s;
+      w->index = i;
+      void* (*run)(void*) = (s == AMIC_STAGE_READ)     ? pipelineReader
+                            : (s == AMIC_STAGE_COMMIT) ? pipelineCommitter
+                                                       : pipelineStage;
+      if (pthread_create(&p->threads[s][i], NULL, run, w) != 0) {
+        return pipelineAbort(p, s, i);
+      }
+    }
+  }
+  return true;
+}
+
+/*
+ * Joins all threads and releases blocks that were read but never committed
+ * because the run stopped early. Returns true when every block up to the
+ * end of the range was committed.
+ */
+bool N(PipelineWait)(N(Pipeline) * p) {
+  pipelineShutdown(p);
+  return !p->failed;
+}
+
+void N(PipelineSnapshot)(N(Pipeline) * p, N(PipelineStats) * out) {
+  for (int s = 0; s < AMIC_STAGE_COUNT; s++) {
+    N(StageStats)* from = &p->stats.stages[s];
+    out->stages[s].items = __atomic_load_n(&from->items, __ATOMIC_RELAXED);
+    out->stages[s].bytes = __atomic_load_n(&from->bytes, __ATOMIC_RELAXED);
+    out->stages[s].fullStalls =
+        __atomic_load_n(&from->fullStalls, __ATOMIC_RELAXED);
+    out->stages[s].emptyStalls =
+        __atomic_load_n(&from->emptyStalls, __ATOMIC_RELAXED);
+  }
+  out->committed = __atomic_load_n(&p->committed, __ATOMIC_ACQUIRE) -
+                   p->cfg.first;
+  out->inFlight = __atomic_load_n(&p->nextRead, __ATOMIC_RELAXED) -
+                  __atomic_load_n(&p->committed, __ATOMIC_RELAXED);
+}
+
+#undef N
+
+#endif /* AMIC_PIPELINE_H_ */
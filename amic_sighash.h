@@ -0,0 +1,95 @@
+#ifndef AMIC_SIGHASH_H_
+#define AMIC_SIGHASH_H_
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+const uint8_t sighashZeros[64] = {0};
+
+void sighashUpdateZeros(N(Hasher) * h, uint32_t len) {
+  while (len > 0) {
+    uint32_t n = (len < sizeof(sighashZeros)) ? len : sizeof(sighashZeros);
+    h->update(h->ctx, sighashZeros, n);
+    len -= n;
+  }
+}
+
+void sighashUpdateLength(N(Hasher) * h, uint32_t len) {
+  uint64_t l = len;
+  h->update(h->ctx, &l, 8);
+}
+
+/*
+ * Locates the lock field of a WitnessArgs and returns the range of its
+ * payload, i.e. the lock bytes after their 4-byte length header. This is
+ * the region sighash-all replaces with zeros.
+ */
+bool N(WitnessArgsLockPayload)(N(WitnessArgs) * a, uint32_t* start,
+                               uint32_t* end) {
+  int offset_count = verifyAndExtractOffsetCount(&a->s, 3, true);
+  if (offset_count < 0) {
+    return false;
+  }
+  uint32_t offset0 = extractOffset(&a->s, 0, offset_count);
+  uint32_t offset1 = extractOffset(&a->s, 1, offset_count);
+  if ((offset1 < offset0) || (offset1 - offset0 < 4) ||
+      (offset1 > a->s.length)) {
+    return false;
+  }
+  *start = offset0 + 4;
+  *end = offset1;
+  return true;
+}
+
+/*
+ * Feeds the sighash-all message of a script group into h, which the caller
+ * has initialized and will finalize: the tx hash, the first group witness
+ * with its lock payload read as zeros, the remaining group witnesses, then
+ * every witness past the transaction's inputs. Each witness is prefixed by
+ * its length as a little endian u64. group holds the input indices of the
+ * script group in ascending order. No witness bytes are copied.
+ */
+bool N(SighashAllUpdate)(N(Hasher) * h, N(Hash) * txHash,
+                         N(BytesDynVec) * witnesses, const uint32_t* group,
+                         uint32_t groupLen, uint32_t inputCount) {
+  uint32_t witnessCount = N(BytesDynVecLen)(witnesses);
+  if ((groupLen == 0) || (group[0] >= witnessCount)) {
+    return false;
+  }
+  N(Bytes) first = N(BytesDynVecGet)(witnesses, group[0]);
+  N(WitnessArgs) args;
+  args.s.p = N(BytesValue)(&first, &args.s.length);
+  uint32_t lockStart, lockEnd;
+  if (!N(WitnessArgsLockPayload)(&args, &lockStart, &lockEnd)) {
+    return false;
+  }
+  h->update(h->ctx, txHash->s.p, txHash->s.length);
+  sighashUpdateLength(h, args.s.length);
+  h->update(h->ctx, args.s.p, lockStart);
+  sighashUpdateZeros(h, lockEnd - lockStart);
+  h->update(h->ctx, &((uint8_t*)args.s.p)[lockEnd], args.s.length - lockEnd);
+  for (uint32_t i = 1; (i < groupLen) && (group[i] < witnessCount); i++) {
+    N(Bytes) w = N(BytesDynVecGet)(witnesses, group[i]);
+    uint32_t len;
+    void* data = N(BytesValue)(&w, &len);
+    sighashUpdateLength(h, len);
+    h->update(h->ctx, data, len);
+  }
+  for (uint32_t i = inputCount; i < witnessCount; i++) {
+    N(Bytes) w = N(BytesDynVecGet)(witnesses, i);
+    uint32_t len;
+    void* data = N(BytesValue)(&w, &len);
+    sighashUpdateLength(h, len);
+    h->update(h->ctx, data, len);
+  }
+  return true;
+}
+
+#undef N
+
+#endif /* AMIC_SIGHASH_H_ */
@@ -0,0 +1,212 @@
+#ifndef AMIC_TEMPLATE_H_
+#define AMIC_TEMPLATE_H_
+
+#include <string.h>
+
+#include "amic_core.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+#define AMIC_TEMPLATE_HEADER 0
+#define AMIC_TEMPLATE_UNCLES 1
+#define AMIC_TEMPLATE_TRANSACTIONS 2
+#define AMIC_TEMPLATE_PROPOSALS 3
+
+/*
+ * A block kept in its final Molecule encoding inside b, starting at offset
+ * 0. Edits splice bytes in place and patch only the offsets they move; the
+ * spare capacity of b absorbs growth, so most edits never reallocate.
+ * b->p may move when it does grow, so take a fresh view after every edit.
+ */
+typedef struct {
+  N(Buffer) * b;
+} N(BlockTemplate);
+
+uint32_t* templateWord(N(BlockTemplate) * t, uint32_t pos) {
+  return (uint32_t*)&t->b->p[pos];
+}
+
+/* Replaces remove bytes at pos with insert uninitialized bytes. */
+bool templateSplice(N(BlockTemplate) * t, uint32_t pos, uint32_t remove,
+                    uint32_t insert) {
+  N(Buffer)* b = t->b;
+  if ((insert > remove) && (!N(BufferReserve)(b, insert - remove))) {
+    return false;
+  }
+  memmove(&b->p[pos + insert], &b->p[pos + remove], b->length - pos - remove);
+  b->length = b->length - remove + insert;
+  return true;
+}
+
+/* Grows or shrinks block field f by delta bytes. */
+void templateResize(N(BlockTemplate) * t, int f, uint32_t delta) {
+  *templateWord(t, 0) += delta;
+  for (int i = f + 1; i <= AMIC_TEMPLATE_PROPOSALS; i++) {
+    *templateWord(t, 4 + 4 * i) += delta;
+  }
+}
+
+uint32_t templateDynVecLen(N(BlockTemplate) * t, uint32_t vec) {
+  if (*templateWord(t, vec) == 4) {
+    return 0;
+  }
+  return *templateWord(t, vec + 4) / 4 - 1;
+}
+
+bool templateDynVecInsert(N(BlockTemplate) * t, int f, uint32_t i,
+                          N(Slice) * item) {
+  uint32_t vec = *templateWord(t, 4 + 4 * f);
+  uint32_t total = *templateWord(t, vec);
+  uint32_t n = templateDynVecLen(t, vec);
+  if ((i > n) || (!N(BufferReserve)(t->b, 4 + item->length))) {
+    return false;
+  }
+  uint32_t body = (i < n) ? *templateWord(t, vec + 4 + 4 * i) : total;
+  templateSplice(t, vec + body, 0, item->length);
+  memcpy(&t->b->p[vec + body], item->p, item->length);
+  templateSplice(t, vec + 4 + 4 * i, 0, 4);
+  for (uint32_t j = 0; j <= n; j++) {
+    uint32_t* offset = templateWord(t, vec + 4 + 4 * j);
+    if (j < i) {
+      *offset += 4;
+    } else if (j == i) {
+      *offset = body + 4;
+    } else {
+      *offset += 4 + item->length;
+    }
+  }
+  *templateWord(t, vec) = total + 4 + item->length;
+  templateResize(t, f, 4 + item->length);
+  return true;
+}
+
+bool templateDynVecRemove(N(BlockTemplate) * t, int f, uint32_t i) {
+  uint32_t vec = *templateWord(t, 4 + 4 * f);
+  uint32_t total = *templateWord(t, vec);
+  uint32_t n = templateDynVecLen(t, vec);
+  if (i >= n) {
+    return false;
+  }
+  uint32_t body = *templateWord(t, vec + 4 + 4 * i);
+  uint32_t end = (i + 1 < n) ? *templateWord(t, vec + 8 + 4 * i) : total;
+  uint32_t length = end - body;
+  templateSplice(t, vec + body, length, 0);
+  templateSplice(t, vec + 4 + 4 * i, 4, 0);
+  for (uint32_t j = 0; j + 1 < n; j++) {
+    *templateWord(t, vec + 4 + 4 * j) -= (j < i) ? 4 : 4 + length;
+  }
+  *templateWord(t, vec) = total - 4 - length;
+  templateResize(t, f, 0 - (4 + length));
+  return true;
+}
+
+/*
+ * Resets b to a block holding header and no uncles, transactions or
+ * proposals.
+ */
+bool N(BlockTemplateInit)(N(BlockTemplate) * t, N(Buffer) * b,
+                          N(Header) * header) {
+  t->b = b;
+  b->length = 0;
+  uint32_t size = 20 + AMIC_HEADER_SIZE + 4 + 4 + 4;
+  if ((header->s.length != AMIC_HEADER_SIZE) ||
+      (!N(BufferReserve)(b, size))) {
+    return false;
+  }
+  b->length = size;
+  *templateWord(t, 0) = size;
+  *templateWord(t, 4) = 20;
+  *templateWord(t, 8) = 20 + AMIC_HEADER_SIZE;
+  *templateWord(t, 12) = 20 + AMIC_HEADER_SIZE + 4;
+  *templateWord(t, 16) = 20 + AMIC_HEADER_SIZE + 8;
+  memcpy(&b->p[20], header->s.p, AMIC_HEADER_SIZE);
+  *templateWord(t, 20 + AMIC_HEADER_SIZE) = 4;
+  *templateWord(t, 24 + AMIC_HEADER_SIZE) = 4;
+  *templateWord(t, 28 + AMIC_HEADER_SIZE) = 0;
+  return true;
+}
+
+N(Block) N(BlockTemplateBlock)(N(BlockTemplate) * t) {
+  N(Block) b;
+  b.s.p = t->b->p;
+  b.s.length = t->b->length;
+  return b;
+}
+
+/* Headers are fixed size, so this never moves other bytes. */
+bool N(BlockTemplateSetHeader)(N(BlockTemplate) * t, N(Header) * header) {
+  if (header->s.length != AMIC_HEADER_SIZE) {
+    return false;
+  }
+  memcpy(&t->b->p[20], header->s.p, AMIC_HEADER_SIZE);
+  return true;
+}
+
+uint32_t N(BlockTemplateTransactionCount)(N(BlockTemplate) * t) {
+  return templateDynVecLen(t, *templateWord(t, 12));
+}
+
+/* Inserts tx before index i; i may equal the count to append. */
+bool N(BlockTemplateInsertTransaction)(N(BlockTemplate) * t, uint32_t i,
+                                       N(Transaction) * tx) {
+  if (!N(TransactionVerify)(tx, false)) {
+    return false;
+  }
+  return templateDynVecInsert(t, AMIC_TEMPLATE_TRANSACTIONS, i, &tx->s);
+}
+
+bool N(BlockTemplateRemoveTransaction)(N(BlockTemplate) * t, uint32_t i) {
+  return templateDynVecRemove(t, AMIC_TEMPLATE_TRANSACTIONS, i);
+}
+
+bool N(BlockTemplateInsertUncle)(N(BlockTemplate) * t, uint32_t i,
+                                 N(UncleBlock) * uncle) {
+  if (!N(UncleBlockVerify)(uncle, false)) {
+    return false;
+  }
+  return templateDynVecInsert(t, AMIC_TEMPLATE_UNCLES, i, &uncle->s);
+}
+
+bool N(BlockTemplateRemoveUncle)(N(BlockTemplate) * t, uint32_t i) {
+  return templateDynVecRemove(t, AMIC_TEMPLATE_UNCLES, i);
+}
+
+uint32_t N(BlockTemplateProposalCount)(N(BlockTemplate) * t) {
+  return *templateWord(t, *templateWord(t, 16));
+}
+
+bool N(BlockTemplateInsertProposal)(N(BlockTemplate) * t, uint32_t i,
+                                    N(ProposalShortId) * id) {
+  uint32_t vec = *templateWord(t, 16);
+  if ((id->s.length != AMIC_PROPOSALSHORTID_SIZE) ||
+      (i > *templateWord(t, vec)) ||
+      (!templateSplice(t, vec + 4 + AMIC_PROPOSALSHORTID_SIZE * i, 0,
+                       AMIC_PROPOSALSHORTID_SIZE))) {
+    return false;
+  }
+  memcpy(&t->b->p[vec + 4 + AMIC_PROPOSALSHORTID_SIZE * i], id->s.p,
+         AMIC_PROPOSALSHORTID_SIZE);
+  *templateWord(t, vec) += 1;
+  templateResize(t, AMIC_TEMPLATE_PROPOSALS, AMIC_PROPOSALSHORTID_SIZE);
+  return true;
+}
+
+bool N(BlockTemplateRemoveProposal)(N(BlockTemplate) * t, uint32_t i) {
+  uint32_t vec = *templateWord(t, 16);
+  if (i >= *templateWord(t, vec)) {
+    return false;
+  }
+  templateSplice(t, vec + 4 + AMIC_PROPOSALSHORTID_SIZE * i,
+                 AMIC_PROPOSALSHORTID_SIZE, 0);
+  *templateWord(t, vec) -= 1;
+  templateResize(t, AMIC_TEMPLATE_PROPOSALS, 0 - AMIC_PROPOSALSHORTID_SIZE);
+  return true;
+}
+
+#undef N
+
+#endif /* AMIC_TEMPLATE_H_ */
@@ -0,0 +1,273 @@
+#ifndef AMIC_UNCLE_H_
+#define AMIC_UNCLE_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "amic_core.h"
+#include "amic_hashset.h"
+
+#ifdef AMIC_NAMESPACE
+#define N(t) AMIC_NAMESPACE##t
+#else
+#define N(t) t
+#endif
+
+#define AMIC_UNCLE_MAX 16
+
+#define AMIC_UNCLE_OK 0
+#define AMIC_UNCLE_ERROR_TOO_MANY 1
+#define AMIC_UNCLE_ERROR_UNCLES_HASH 2
+#define AMIC_UNCLE_ERROR_PROPOSALS_HASH 3
+#define AMIC_UNCLE_ERROR_DUPLICATE 4
+#define AMIC_UNCLE_ERROR_DIFFICULTY_OVERFLOW 5
+
+/* Little endian 64-bit limbs. */
+typedef struct {
+  uint64_t w[4];
+} N(U256);
+
+/* a += b; returns true on overflow. */
+bool N(U256Add)(N(U256) * a, const N(U256) * b) {
+  uint64_t carry = 0;
+  for (int i = 0; i < 4; i++) {
+    uint64_t sum = a->w[i] + carry;
+    carry = sum < carry;
+    a->w[i] = sum + b->w[i];
+    carry += a->w[i] < sum;
+  }
+  return carry != 0;
+}
+
+int N(U256Compare)(const N(U256) * a, const N(U256) * b) {
+  for (int i = 3; i >= 0; i--) {
+    if (a->w[i] != b->w[i]) {
+      return (a->w[i] < b->w[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+/* floor(2^power / d) for power <= 256 and 2 <= d < 2^32. */
+N(U256) uncleDividePower(uint32_t power, uint32_t d) {
+  N(U256) q;
+  memset(&q, 0, sizeof(q));
+  uint64_t r = 0;
+  for (int limb = 8; limb >= 0; limb--) {
+    uint64_t digit = (power / 32 == (uint32_t)limb) ? 1ULL << (power % 32) : 0;
+    uint64_t cur = (r << 32) | digit;
+    uint64_t quotient = cur / d;
+    r = cur % d;
+    if (limb < 8) {
+      q.w[limb / 2] |= quotient << ((limb % 2) * 32);
+    }
+  }
+  return q;
+}
+
+/*
+ * Difficulty of a compact target, matching CKB: the target is
+ * mantissa * 256^(exponent - 3), difficulty is floor(2^256 / target),
+ * a target of 1 maps to the maximum value and a zero or overflowing
+ * target to zero. Since the target is a 24-bit mantissa times a power of
+ * two, the division is a short division of a power of two.
+ */
+N(U256) N(CompactToDifficulty)(uint32_t compact) {
+  N(U256) d;
+  memset(&d, 0, sizeof(d));
+  uint32_t exponent = compact >> 24;
+  uint32_t mantissa = compact & 0x00ffffff;
+  uint32_t shift = 0;
+  if (exponent <= 3) {
+    mantissa >>= 8 * (3 - exponent);
+  } else if (exponent > 32) {
+    return d;
+  } else {
+    shift = 8 * (exponent - 3);
+  }
+  if (mantissa == 0) {
+    return d;
+  }
+  while ((mantissa % 2 == 0) && (mantissa > 1)) {
+    mantissa /= 2;
+    shift++;
+  }
+  if ((mantissa == 1) && (shift == 0)) {
+    memset(&d, 0xff, sizeof(d));
+    return d;
+  }
+  if (mantissa == 1) {
+    d.w[(256 - shift) / 64] = 1ULL << ((256 - shift) % 64);
+    return d;
+  }
+  return uncleDividePower(256 - shift, mantissa);
+}
+
+/*
+ * Adds the difficulty of every header to total. Compact targets only change
+ * at epoch boundaries, so runs of equal targets are converted once.
+ * Returns false if total overflows.
+ */
+bool N(DifficultyAccumulate)(N(Header) * headers, uint32_t count,
+                             N(U256) * total) {
+  uint32_t last = 0;
+  N(U256) difficulty;
+  memset(&difficulty, 0, sizeof(difficulty));
+  bool ok = true;
+  for (uint32_t i = 0; i < count; i++) {
+    N(RawHeader) raw = N(HeaderRawHeader)(&headers[i]);
+    uint32_t compact = N(RawHeaderCompactTarget)(&raw);
+    if ((i == 0) || (compact != last)) {
+      difficulty = N(CompactToDifficulty)(compact);
+      last = compact;
+    }
+    ok = (!N(U256Add)(total, &difficulty)) && ok;
+  }
+  return ok;
+}
+
+/*
+ * Hashes of the uncles accepted over a recent window of blocks: a ring of
+ * the hashes in arrival order plus a hash set over it whose slots hold
+ * 1-based ring positions. When full, the oldest hash is dropped.
+ */
+typedef struct {
+  uint8_t* hashes;
+  hashSet set;
+  uint32_t capacity;
+  uint32_t head;
+  uint32_t count;
+} N(UncleWindow);
+
+/* capacity must be between 1 and AMIC_HASHSET_MAX. */
+bool N(UncleWindowInit)(N(UncleWindow) * w, uint32_t capacity) {
+  if ((capacity == 0) || (!hashSetInit(&w->set, capacity))) {
+    return false;
+  }
+  w->hashes = (uint8_t*)malloc((size_t)capacity * AMIC_HASH_SIZE);
+  if (w->hashes == NULL) {
+    hashSetDestroy(&w->set);
+    return false;
+  }
+  w->capacity = capacity;
+  w->head = 0;
+  w->count = 0;
+  return true;
+}
+
+void N(UncleWindowDestroy)(N(UncleWindow) * w) {
+  free(w->hashes);
+  hashSetDestroy(&w->set);
+}
+
+const uint8_t* uncleKey(void* ctx, uint32_t slot) {
+  return &((N(UncleWindow)*)ctx)->hashes[(slot - 1) * AMIC_HASH_SIZE];
+}
+
+uint32_t uncleFind(N(UncleWindow) * w, const uint8_t* hash) {
+  return hashSetFind(&w->set, hash, uncleKey, w);
+}
+
+bool N(UncleWindowContains)(N(UncleWindow) * w, const uint8_t* hash) {
+  return w->set.slots[uncleFind(w, hash)] != 0;
+}
+
+void N(UncleWindowInsert)(N(UncleWindow) * w, const uint8_t* hash) {
+  if (N(UncleWindowContains)(w, hash)) {
+    return;
+  }
+  uint8_t* entry = &w->hashes[w->head * AMIC_HASH_SIZE];
+  if (w->count == w->capacity) {
+    hashSetErase(&w->set, uncleFind(w, entry), uncleKey, w);
+  } else {
+    w->count++;
+  }
+  memcpy(entry, hash, AMIC_HASH_SIZE);
+  w->set.slots[uncleFind(w, hash)] = w->head + 1;
+  w->head = (w->head + 1) % w->capacity;
+}
+
+/* Zero for an empty vector, otherwise the hash of the concatenated ids. */
+void uncleProposalsHash(N(Hasher) * h, N(ProposalShortIdFixVec) * v,
+                        uint8_t* out) {
+  uint32_t len = N(ProposalShortIdFixVecLen)(v);
+  if (len == 0) {
+    memset(out, 0, AMIC_HASH_SIZE);
+    return;
+  }
+  N(HasherHash)(h, &((uint8_t*)v->s.p)[4], len * AMIC_PROPOSALSHORTID_SIZE,
+                out);
+}
+
+/*
+ * Checks the uncles of a verified block in one pass: each uncle's
+ * proposals must hash to its header's proposals hash, the uncle header
+ * hashes must combine to the block's uncles hash, and no uncle may repeat
+ * within the block or the window. On success the uncle hashes enter the
+ * window and, when total is given, the block's difficulty is added to
+ * it. On failure the offending uncle index is stored in failed, and
+ * neither the window nor total changes; an overflowing total fails the
+ * check too.
+ */
+int N(UnclesCheck)(N(Block) * b, N(Hasher) * h, N(UncleWindow) * w,
+                   uint32_t* failed, N(U256) * total) {
+  N(Header) header = N(BlockHeader)(b);
+  N(RawHeader) raw = N(HeaderRawHeader)(&header);
+  N(UncleBlockDynVec) uncles = N(BlockUncles)(b);
+  uint32_t n = N(UncleBlockDynVecLen)(&uncles);
+  uint8_t hashes[AMIC_UNCLE_MAX * AMIC_HASH_SIZE];
+  uint8_t expected[AMIC_HASH_SIZE];
+  if (n > AMIC_UNCLE_MAX) {
+    return AMIC_UNCLE_ERROR_TOO_MANY;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    *failed = i;
+    N(UncleBlock) uncle = N(UncleBlockDynVecGet)(&uncles, i);
+    N(Header) uh = N(UncleBlockHeader)(&uncle);
+    N(RawHeader) ur = N(HeaderRawHeader)(&uh);
+    N(ProposalShortIdFixVec) proposals = N(UncleBlockProposals)(&uncle);
+    N(Hash) proposalsHash = N(RawHeaderProposalsHash)(&ur);
+    uncleProposalsHash(h, &proposals, expected);
+    if (memcmp(expected, proposalsHash.s.p, AMIC_HASH_SIZE) != 0) {
+      return AMIC_UNCLE_ERROR_PROPOSALS_HASH;
+    }
+    uint8_t* hash = &hashes[i * AMIC_HASH_SIZE];
+    N(HasherHash)(h, uh.s.p, uh.s.length, hash);
+    if (N(UncleWindowContains)(w, hash)) {
+      return AMIC_UNCLE_ERROR_DUPLICATE;
+    }
+    for (uint32_t j = 0; j < i; j++) {
+      if (memcmp(&hashes[j * AMIC_HASH_SIZE], hash, AMIC_HASH_SIZE) == 0) {
+        return AMIC_UNCLE_ERROR_DUPLICATE;
+      }
+    }
+  }
+  *failed = n;
+  if (n == 0) {
+    memset(expected, 0, AMIC_HASH_SIZE);
+  } else {
+    N(HasherHash)(h, hashes, n * AMIC_HASH_SIZE, expected);
+  }
+  N(Hash) unclesHash = N(RawHeaderUnclesHash)(&raw);
+  if (memcmp(expected, unclesHash.s.p, AMIC_HASH_SIZE) != 0) {
+    return AMIC_UNCLE_ERROR_UNCLES_HASH;
+  }
+  N(U256) sum;
+  if (total != NULL) {
+    sum = *total;
+    if (!N(DifficultyAccumulate)(&header, 1, &sum)) {
+      return AMIC_UNCLE_ERROR_DIFFICULTY_OVERFLOW;
+    }
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    N(UncleWindowInsert)(w, &hashes[i * AMIC_HASH_SIZE]);
+  }
+  if (total != NULL) {
+    *total = sum;
+  }
+  return AMIC_UNCLE_OK;
+}
+
+#undef N
+
+#endif /* AMIC_UNCLE_H_ */
@@ -0,0 +1,225 @@
+/*
+ * Differential check of TransactionVerifyBatch against TransactionVerify.
+ * Builds small valid transactions, corrupts some of them at random and
+ * requires the batch result bit of every transaction to match the single
+ * verifier, in both compatible and strict mode. Then times both paths on
+ * valid transactions. Build and run from the repository root:
+ *
+ *   cc -std=c99 -O2 -Wno-unused-function -o batch_diff tools/batch_diff.c
+ *   ./batch_diff [rounds]
+ *
+ * Exits nonzero on any mismatch.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../amic_batch.h"
+
+#define TXS 4000
+
+typedef struct {
+  uint8_t* p;
+  uint32_t length;
+  uint32_t capacity;
+} buffer;
+
+void put(buffer* b, const void* data, uint32_t length) {
+  if (b->length + length > b->capacity) {
+    b->capacity = (b->length + length) * 2 + 64;
+    b->p = (uint8_t*)realloc(b->p, b->capacity);
+    if (b->p == NULL) {
+      abort();
+    }
+  }
+  if (length > 0) {
+    memcpy(&b->p[b->length], data, length);
+  }
+  b->length += length;
+}
+
+void put32(buffer* b, uint32_t v) { put(b, &v, 4); }
+
+void put64(buffer* b, uint64_t v) { put(b, &v, 8); }
+
+/* Serializes a table of the fields and frees them. */
+buffer table(buffer* fields, int n) {
+  buffer b = {0};
+  uint32_t offset = 4 * (n + 1);
+  uint32_t total = offset;
+  for (int i = 0; i < n; i++) {
+    total += fields[i].length;
+  }
+  put32(&b, total);
+  for (int i = 0; i < n; i++) {
+    put32(&b, offset);
+    offset += fields[i].length;
+  }
+  for (int i = 0; i < n; i++) {
+    put(&b, fields[i].p, fields[i].length);
+    free(fields[i].p);
+  }
+  return b;
+}
+
+buffer bytes(const char* s) {
+  buffer b = {0};
+  put32(&b, (uint32_t)strlen(s));
+  put(&b, s, (uint32_t)strlen(s));
+  return b;
+}
+
+buffer script(uint8_t codeHash, uint8_t hashType, const char* args) {
+  buffer f[3] = {{0}};
+  uint8_t hash[AMIC_HASH_SIZE];
+  memset(hash, codeHash, sizeof(hash));
+  put(&f[0], hash, sizeof(hash));
+  put(&f[1], &hashType, 1);
+  f[2] = bytes(args);
+  return table(f, 3);
+}
+
+buffer output(uint64_t capacity, bool withType) {
+  buffer f[3] = {{0}};
+  put64(&f[0], capacity);
+  f[1] = script(1, AMIC_DATA, "lock");
+  if (withType) {
+    f[2] = script(2, AMIC_TYPE, "type");
+  }
+  return table(f, 3);
+}
+
+buffer transaction(int inputs, int outputs, uint32_t salt) {
+  buffer f[6] = {{0}};
+  put32(&f[0], 0);
+  uint8_t dep[AMIC_CELLDEP_SIZE];
+  memset(dep, 7, sizeof(dep));
+  dep[AMIC_OUTPOINT_SIZE] = AMIC_DEPGROUP;
+  put32(&f[1], 1);
+  put(&f[1], dep, sizeof(dep));
+  put32(&f[2], 0);
+  put32(&f[3], inputs);
+  for (int i = 0; i < inputs; i++) {
+    uint8_t input[AMIC_CELLINPUT_SIZE] = {0};
+    memset(&input[8], salt + i, AMIC_HASH_SIZE);
+    input[40] = (uint8_t)i;
+    put(&f[3], input, sizeof(input));
+  }
+  buffer outs[8];
+  buffer data[8];
+  for (int i = 0; i < outputs; i++) {
+    outs[i] = output(1000 + i, i % 3 == 0);
+    data[i] = bytes(&"xyz"[3 - i % 4]);
+  }
+  f[4] = table(outs, outputs);
+  f[5] = table(data, outputs);
+  buffer w[2] = {bytes("sig"), bytes("")};
+  buffer t[2] = {table(f, 6), table(w, 2)};
+  return table(t, 2);
+}
+
+uint64_t state = 88172645463325252ULL;
+
+uint64_t next() {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+/*
+ * Flips bits, writes small values or nudges offsets. Sometimes first adds
+ * 2^30 to a fixed vector count, which a 32-bit length check would let
+ * through since every item size here is a multiple of four.
+ */
+void corrupt(buffer* b) {
+  if (next() % 8 == 0) {
+    uint8_t* raw = &b->p[*((uint32_t*)&b->p[4])];
+    uint32_t field = 1 + next() % 3;
+    raw[*((uint32_t*)&raw[4 + 4 * field]) + 3] += 0x40;
+  }
+  int n = next() % 4;
+  for (int i = 0; i < n; i++) {
+    uint32_t pos = next() % b->length;
+    switch (next() % 3) {
+      case 0:
+        b->p[pos] ^= 1 << (next() % 8);
+        break;
+      case 1:
+        b->p[pos] = next() % 3;
+        break;
+      default:
+        b->p[pos] += (next() % 2) ? 4 : -4;
+    }
+  }
+  if (next() % 20 == 0) {
+    b->length -= next() % 8;
+  }
+}
+
+int main(int argc, char** argv) {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 40;
+  Transaction* txs = (Transaction*)calloc(TXS, sizeof(Transaction));
+  uint64_t* results = (uint64_t*)calloc((TXS + 63) / 64, sizeof(uint64_t));
+  long mismatches = 0;
+  long passed = 0;
+  for (int round = 0; round < rounds; round++) {
+    for (int i = 0; i < TXS; i++) {
+      buffer b = transaction(next() % 4, 1 + next() % 4, i);
+      corrupt(&b);
+      txs[i].s.p = b.p;
+      txs[i].s.length = b.length;
+    }
+    for (int compatible = 0; compatible < 2; compatible++) {
+      uint32_t n = TransactionVerifyBatch(txs, TXS, compatible, results);
+      uint32_t expected = 0;
+      for (int i = 0; i < TXS; i++) {
+        bool single = TransactionVerify(&txs[i], compatible);
+        bool batch = (results[i / 64] >> (i % 64)) & 1;
+        if (single != batch) {
+          if (mismatches < 8) {
+            printf("mismatch: round %d tx %d compatible %d core %d\n", round,
+                   i, compatible, single);
+          }
+          mismatches++;
+        }
+        expected += single;
+      }
+      mismatches += (n != expected);
+      passed += n;
+    }
+    for (int i = 0; i < TXS; i++) {
+      free(txs[i].s.p);
+    }
+  }
+  printf("%ld mismatches, %ld of %ld passed\n", mismatches, passed,
+         2L * rounds * TXS);
+
+  for (int i = 0; i < TXS; i++) {
+    buffer b = transaction(1 + i % 2, 2, i);
+    txs[i].s.p = b.p;
+    txs[i].s.length = b.length;
+  }
+  uint64_t sum = 0;
+  clock_t start = clock();
+  for (int r = 0; r < 200; r++) {
+    for (int i = 0; i < TXS; i++) {
+      sum += TransactionVerify(&txs[i], false);
+    }
+  }
+  clock_t middle = clock();
+  for (int r = 0; r < 200; r++) {
+    sum += TransactionVerifyBatch(txs, TXS, false, results);
+  }
+  clock_t end = clock();
+  printf("single %.1fms, batch %.1fms (%llu)\n",
+         (middle - start) * 1e3 / CLOCKS_PER_SEC,
+         (end - middle) * 1e3 / CLOCKS_PER_SEC, (unsigned long long)sum);
+  for (int i = 0; i < TXS; i++) {
+    free(txs[i].s.p);
+  }
+  free(txs);
+  free(results);
+  return mismatches != 0;
+}